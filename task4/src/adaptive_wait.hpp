@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <sched.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Параметры адаптивного ожидания: сначала процесс `spin_limit` раз проверяет
+// условие в цикле с инструкцией `pause`, затем `yield_limit` раз проверяет
+// его, уступая процессор вызовом `sched_yield()`, и только после этого
+// засыпает в ядре. При нулевых значениях процесс засыпает сразу.
+struct WaitPolicy {
+  int spin_limit = 0;
+  int yield_limit = 0;
+
+  bool IsAdaptive() const { return spin_limit > 0 || yield_limit > 0; }
+
+  // Читает параметры из переменных среды WAIT_SPIN и WAIT_YIELD.
+  static WaitPolicy FromEnv() {
+    WaitPolicy policy;
+    policy.spin_limit = ReadEnv("WAIT_SPIN");
+    policy.yield_limit = ReadEnv("WAIT_YIELD");
+    return policy;
+  }
+
+private:
+  static int ReadEnv(const char* name) {
+    char* value = getenv(name);
+    if (value == NULL) {
+      return 0;
+    }
+    int result = std::stoi(value);
+    if (result < 0) {
+      throw std::runtime_error(std::string(name) + " should be non-negative");
+    }
+    return result;
+  }
+};
+
+// Статистика того, на какой фазе адаптивного ожидания выполнилось условие.
+struct WaitStats {
+  // Условие выполнилось сразу, без ожидания.
+  uint64_t immediate = 0;
+  uint64_t spin = 0;
+  uint64_t yield = 0;
+  // Процессу пришлось заснуть в ядре.
+  uint64_t block = 0;
+
+  void Print(const std::string& name) const {
+    std::cerr << name << " wait stats: immediate " << immediate << ", spin " << spin
+              << ", yield " << yield << ", block " << block << std::endl;
+  }
+};
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#endif
+}
+
+// Ожидает выполнения условия согласно `policy`. `try_wait()` должна
+// неблокирующе попытаться выполнить условие и вернуть true в случае успеха,
+// `wait()` - дождаться его выполнения, заснув в ядре.
+template <typename TryWait, typename Wait>
+void AdaptiveWait(const WaitPolicy& policy, WaitStats& stats, TryWait try_wait, Wait wait) {
+  if (try_wait()) {
+    ++stats.immediate;
+    return;
+  }
+  for (int i = 0; i < policy.spin_limit; ++i) {
+    CpuRelax();
+    if (try_wait()) {
+      ++stats.spin;
+      return;
+    }
+  }
+  for (int i = 0; i < policy.yield_limit; ++i) {
+    sched_yield();
+    if (try_wait()) {
+      ++stats.yield;
+      return;
+    }
+  }
+  ++stats.block;
+  wait();
+}
@@ -0,0 +1,65 @@
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "event_log.hpp"
+
+// Программа, переводящая бинарный лог `dish_washing` (LOG_FORMAT=binary) в
+// текстовый формат, совпадающий с текстовым логом программы. Лог читается из
+// файла, переданного первым аргументом, или из stdin.
+int main(int argc, char** argv) {
+  if (argc > 2) {
+    throw std::runtime_error("Incorrect number of arguments");
+  }
+  std::ifstream file;
+  if (argc == 2) {
+    file.open(argv[1], std::ios::binary);
+    if (!file) {
+      throw std::runtime_error(std::string("Couldn't open file ") + argv[1]);
+    }
+  }
+  std::istream& reader = argc == 2 ? file : std::cin;
+
+  // Названия посуды каждого работника по идентификаторам.
+  std::map<std::pair<WorkerId, uint16_t>, std::string> dish_types;
+  std::vector<char> frame;
+  FrameHeader header;
+  while (reader.read((char*)&header, sizeof(FrameHeader))) {
+    if (header.magic != FrameHeader::kMagic || header.size > FrameHeader::kMaxFrameSize) {
+      throw std::runtime_error("Corrupted binary log");
+    }
+    frame.resize(header.size);
+    if (!reader.read(frame.data(), header.size)) {
+      throw std::runtime_error("Unexpected end of binary log");
+    }
+    for (size_t position = 0; position < frame.size();) {
+      if (position + sizeof(EventRecord) > frame.size()) {
+        throw std::runtime_error("Corrupted binary log");
+      }
+      EventRecord record;
+      memcpy(&record, frame.data() + position, sizeof(EventRecord));
+      position += sizeof(EventRecord);
+      if (record.kind == EventKind::DishName) {
+        if (record.duration < 0 || position + record.duration > frame.size()) {
+          throw std::runtime_error("Corrupted binary log");
+        }
+        dish_types[{record.worker, record.dish_id}] =
+            std::string(frame.data() + position, record.duration);
+        position += record.duration;
+        continue;
+      }
+      std::string dish_type;
+      if (record.kind != EventKind::TryingToGet && record.kind != EventKind::Finished) {
+        dish_type = dish_types.at({record.worker, record.dish_id});
+      }
+      std::cout << FormatEvent(record.worker, TimestampToSecond(record.timestamp_ms), record.kind,
+                               dish_type, record.duration)
+                << '\n';
+    }
+  }
+  if (!reader.eof()) {
+    throw std::runtime_error("Error while reading binary log");
+  }
+  return 0;
+}
@@ -6,6 +6,11 @@
 #include "message_workers.hpp"
 #include "socket_workers.hpp"
 #include "shm_workers.hpp"
+#include "eventfd_workers.hpp"
+#include "uring_workers.hpp"
+#include "memfd_workers.hpp"
+#include "posix_mq_workers.hpp"
+#include "splice_workers.hpp"
 
 struct Args {
   std::string washing_times_filepath;
@@ -13,6 +18,24 @@ struct Args {
   std::string dishes_filepath;
   int table_limit;
   std::string workers_type;
+  // Использовать ли огромные страницы для разделяемой памяти работников
+  // `memfd` (задается переменной среды HUGE_PAGES=1).
+  bool huge_pages = false;
+  // Политика ожидания для работников `shm` (переменные среды WAIT_SPIN и
+  // WAIT_YIELD).
+  WaitPolicy wait_policy;
+  // Взаимное расположение процессов работников (переменная среды PLACEMENT).
+  Placement placement = Placement::Any;
+  // Писать ли лог в бинарном формате (переменная среды LOG_FORMAT=binary).
+  bool binary_log = false;
+  // Количество посуды в одном сообщении и количество мест, возвращаемых
+  // одним сообщением, для работников `mq` (переменные среды MQ_BATCH и
+  // MQ_CREDIT_WINDOW).
+  int mq_batch = 1;
+  int mq_credit_window = 1;
+  // Размер полезной нагрузки каждой посуды в байтах для работников `pipe` и
+  // `splice` (переменная среды DISH_PAYLOAD_SIZE).
+  size_t payload_size = 0;
 
   static Args Parse(int argc, char** argv) {
     if (argc != 5) {
@@ -31,6 +54,44 @@ struct Args {
     }
     args.table_limit = std::stoi(table_limit_var);
 
+    char* huge_pages_var = getenv("HUGE_PAGES");
+    args.huge_pages = huge_pages_var != NULL && std::string(huge_pages_var) == "1";
+
+    args.wait_policy = WaitPolicy::FromEnv();
+
+    char* placement_var = getenv("PLACEMENT");
+    if (placement_var != NULL) {
+      args.placement = ParsePlacement(placement_var);
+    }
+
+    char* log_format_var = getenv("LOG_FORMAT");
+    if (log_format_var != NULL) {
+      const std::string log_format(log_format_var);
+      if (log_format != "text" && log_format != "binary") {
+        throw std::runtime_error("Unexpected log format: " + log_format);
+      }
+      args.binary_log = log_format == "binary";
+    }
+
+    char* mq_batch_var = getenv("MQ_BATCH");
+    if (mq_batch_var != NULL) {
+      args.mq_batch = std::stoi(mq_batch_var);
+    }
+
+    char* mq_credit_window_var = getenv("MQ_CREDIT_WINDOW");
+    if (mq_credit_window_var != NULL) {
+      args.mq_credit_window = std::stoi(mq_credit_window_var);
+    }
+
+    char* payload_size_var = getenv("DISH_PAYLOAD_SIZE");
+    if (payload_size_var != NULL) {
+      const long long payload_size = std::stoll(payload_size_var);
+      if (payload_size < 0) {
+        throw std::runtime_error("DISH_PAYLOAD_SIZE should be non-negative");
+      }
+      args.payload_size = payload_size;
+    }
+
     return args;
   }
 };
@@ -39,15 +100,19 @@ struct Args {
 std::pair<std::unique_ptr<Washer>, std::unique_ptr<Wiper>>
 CreateWorkers(const Times& washing_times,
               const Times& wiping_times,
-              int table_limit,
-              const std::string& type) {
+              const Args& args) {
+  const int table_limit = args.table_limit;
+  const std::string& type = args.workers_type;
+  if (args.payload_size > 0 && type != "pipe" && type != "splice") {
+    throw std::runtime_error("DISH_PAYLOAD_SIZE is supported only by pipe and splice workers");
+  }
   if (type == "fifo") {
     auto shared_state = std::make_shared<FifoSharedState>(table_limit);
     return {std::make_unique<FifoWasher>(washing_times, shared_state),
             std::make_unique<FifoWiper>(wiping_times, shared_state)};
   }
   if (type == "pipe") {
-    auto shared_state = std::make_shared<PipeSharedState>(table_limit);
+    auto shared_state = std::make_shared<PipeSharedState>(table_limit, args.payload_size);
     return {std::make_unique<PipeWasher>(washing_times, shared_state),
             std::make_unique<PipeWiper>(wiping_times, shared_state)};
   }
@@ -57,7 +122,7 @@ CreateWorkers(const Times& washing_times,
             std::make_unique<MessageWiper>(wiping_times, shared_state)};
   }
   if (type == "shm") {
-    auto shared_state = std::make_shared<ShmSharedState>(table_limit);
+    auto shared_state = std::make_shared<ShmSharedState>(table_limit, args.wait_policy);
     return {std::make_unique<ShmWasher>(washing_times, shared_state),
             std::make_unique<ShmWiper>(wiping_times, shared_state)};
   }
@@ -66,18 +131,94 @@ CreateWorkers(const Times& washing_times,
     return {std::make_unique<SocketWasher>(washing_times, shared_state),
             std::make_unique<SocketWiper>(wiping_times, shared_state)};
   }
+  if (type == "eventfd") {
+    auto shared_state = std::make_shared<EventfdSharedState>(table_limit);
+    return {std::make_unique<EventfdWasher>(washing_times, shared_state),
+            std::make_unique<EventfdWiper>(wiping_times, shared_state)};
+  }
+  if (type == "uring") {
+    auto shared_state = std::make_shared<PipeSharedState>(table_limit);
+    if (!IoUring::IsSupported()) {
+      // Ядро не поддерживает io_uring - используем обычные pipe'ы.
+      std::cerr << "io_uring is not supported, falling back to pipe workers" << std::endl;
+      return {std::make_unique<PipeWasher>(washing_times, shared_state),
+              std::make_unique<PipeWiper>(wiping_times, shared_state)};
+    }
+    return {std::make_unique<UringWasher>(washing_times, shared_state),
+            std::make_unique<UringWiper>(wiping_times, shared_state)};
+  }
+  if (type == "memfd") {
+    auto shared_state = std::make_shared<MemfdSharedState>(table_limit, args.huge_pages);
+    return {std::make_unique<MemfdWasher>(washing_times, shared_state),
+            std::make_unique<MemfdWiper>(wiping_times, shared_state)};
+  }
+  if (type == "mq") {
+    auto shared_state =
+        std::make_shared<PosixMqSharedState>(table_limit, args.mq_batch, args.mq_credit_window);
+    return {std::make_unique<PosixMqWasher>(washing_times, shared_state),
+            std::make_unique<PosixMqWiper>(wiping_times, shared_state)};
+  }
+  if (type == "splice") {
+    auto shared_state = std::make_shared<SpliceSharedState>(table_limit, args.payload_size);
+    return {std::make_unique<SpliceWasher>(washing_times, shared_state),
+            std::make_unique<SpliceWiper>(wiping_times, shared_state)};
+  }
   throw std::runtime_error("Unexpected type of workers: " + type);
 }
 
+// Проверяет, что расположение из переменной среды PLACEMENT возможно на
+// этой машине: выбирает процессоры мойщика и вытирателя, привязывается к
+// каждому из них и выводит их номера. Бросает исключение, если расположение
+// невозможно. Используется `make task4-bench`, чтобы отличать невозможные
+// расположения от ошибок работников.
+void CheckPlacement() {
+  char* placement_var = getenv("PLACEMENT");
+  const Placement placement = placement_var == NULL ? Placement::Any : ParsePlacement(placement_var);
+  if (placement == Placement::Any) {
+    std::cout << "any" << std::endl;
+    return;
+  }
+  auto cpus = CpuTopology::Load().ChooseCpus(placement);
+  BindToCpu(cpus.first);
+  BindToCpu(cpus.second);
+  std::cout << "washer " << cpus.first << ", wiper " << cpus.second << std::endl;
+}
+
 int main(int argc, char** argv) {
+  if (argc == 2 && std::string(argv[1]) == "--check-placement") {
+    CheckPlacement();
+    return 0;
+  }
   const Args args = Args::Parse(argc, argv);
+  Worker::UseBinaryLog(args.binary_log);
 
   Times washing_times = Times::LoadFromFile(args.washing_times_filepath);
   Times wiping_times = Times::LoadFromFile(args.wiping_times_filepath);
   WashTaskQueue queue = WashTaskQueue::LoadFromFile(args.dishes_filepath);
 
-  auto workers = CreateWorkers(washing_times, wiping_times, args.table_limit, args.workers_type);
+  // Привязываем главный процесс (мойщика) к процессору до создания
+  // разделяемого состояния: память выделяется на узле NUMA процессора,
+  // который первым к ней обратился, поэтому участки разделяемой памяти
+  // окажутся локальными для мойщика.
+  int wiper_cpu = -1;
+  if (args.placement != Placement::Any) {
+    auto cpus = CpuTopology::Load().ChooseCpus(args.placement);
+    BindToCpu(cpus.first);
+    wiper_cpu = cpus.second;
+  }
+
+  auto workers = CreateWorkers(washing_times, wiping_times, args);
+  workers.second->SetCpu(wiper_cpu);
   workers.second->Work();
-  workers.first->Work(queue);
+  try {
+    workers.first->Work(queue);
+  }
+  catch (...) {
+    // Задачи читаются из файла по мере работы, поэтому ошибка в файле может
+    // обнаружиться уже после запуска вытирателя.
+    workers.second->Kill();
+    workers.second->Join();
+    throw;
+  }
   workers.second->Join();
 }
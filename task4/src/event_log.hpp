@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+#include "utils.hpp"
+
+// Работник, записавший событие.
+enum struct WorkerId : uint8_t {
+  Washer,
+  Wiper,
+};
+
+// Вид события в логе работника.
+enum struct EventKind : uint8_t {
+  Wash,
+  TryingToPut,
+  Put,
+  TryingToGet,
+  Got,
+  Wipe,
+  Finished,
+  // Служебная запись бинарного лога: сопоставляет идентификатор посуды с ее
+  // названием. За заголовком записи следует `duration` байт названия.
+  DishName,
+};
+
+// Имя работника в тексте лога.
+inline std::string WorkerName(WorkerId worker) {
+  return worker == WorkerId::Washer ? "WASHER" : "WIPER ";
+}
+
+// Возвращает строку лога для события. Используется как при текстовом
+// логировании, так и при декодировании бинарного лога, поэтому формат у них
+// гарантированно совпадает.
+inline std::string FormatEvent(WorkerId worker, int second, EventKind kind,
+                               const std::string& dish_type, int duration) {
+  std::string message;
+  switch (kind) {
+    case EventKind::Wash:
+      message = "Wash " + dish_type + " for " + std::to_string(duration) + " seconds";
+      break;
+    case EventKind::TryingToPut:
+      message = "Trying to put " + dish_type + " on the table";
+      break;
+    case EventKind::Put:
+      message = "Put " + dish_type + " on the table";
+      break;
+    case EventKind::TryingToGet:
+      message = "Trying to get dish from the table";
+      break;
+    case EventKind::Got:
+      message = "Got " + dish_type + " from the table";
+      break;
+    case EventKind::Wipe:
+      message = "Wipe " + dish_type + " for " + std::to_string(duration) + " seconds";
+      break;
+    case EventKind::Finished:
+      message = "Finished work";
+      break;
+    case EventKind::DishName:
+      throw std::runtime_error("Dish name record is not a log event");
+  }
+  return WorkerName(worker) + " " + std::to_string(second) + " sec: " + message;
+}
+
+// Переводит время от старта работника в секунды лога.
+inline int TimestampToSecond(uint32_t timestamp_ms) {
+  return (timestamp_ms + 100) / 1000;
+}
+
+// Заголовок записи бинарного лога.
+struct EventRecord {
+  // Время от создания работника в миллисекундах.
+  uint32_t timestamp_ms;
+  // Длительность мытья/вытирания или длина названия посуды для `DishName`.
+  int32_t duration;
+  uint16_t dish_id;
+  WorkerId worker;
+  EventKind kind;
+};
+static_assert(sizeof(EventRecord) == 12);
+
+// Заголовок фрейма бинарного лога. Фоновый писатель каждого процесса
+// записывает фрейм с целыми записями одним вызовом `write()` размером не
+// больше `PIPE_BUF`, поэтому фреймы двух процессов, пишущих в общий stdout, не
+// перемешиваются.
+struct FrameHeader {
+  uint32_t magic;
+  uint32_t size;
+
+  static constexpr uint32_t kMagic = 0x444c4f47;
+  static constexpr size_t kMaxFrameSize = 4096;
+};
+
+// Бинарный лог событий одного процесса. Рабочий поток складывает записи в
+// кольцевой буфер без блокировок (один писатель, один читатель), а фоновый
+// поток забирает их и пишет фреймами в файловый дескриптор. Названия посуды
+// передаются в лог один раз, при первом появлении, а дальше на посуду
+// ссылаются по идентификатору.
+class BinaryEventLog {
+public:
+  BinaryEventLog(WorkerId worker, int fd = STDOUT_FILENO)
+    : worker(worker), fd(fd), buffer(kBufferSize), writer(&BinaryEventLog::Drain, this) {}
+
+  BinaryEventLog(const BinaryEventLog&) = delete;
+  BinaryEventLog& operator=(const BinaryEventLog&) = delete;
+
+  // Дожидается записи всех событий и останавливает фоновый поток.
+  ~BinaryEventLog() {
+    stop.store(true, std::memory_order_release);
+    writer.join();
+  }
+
+  void Record(uint32_t timestamp_ms, EventKind kind, const std::string& dish_type, int duration) {
+    uint16_t dish_id = 0;
+    if (!dish_type.empty()) {
+      auto iter = dish_ids.find(dish_type);
+      if (iter == dish_ids.end()) {
+        if (dish_ids.size() > UINT16_MAX) {
+          throw std::runtime_error("Too many dish types for binary log");
+        }
+        iter = dish_ids.insert({dish_type, dish_ids.size()}).first;
+        EventRecord name{timestamp_ms, (int32_t)dish_type.size(), iter->second, worker,
+                         EventKind::DishName};
+        Append(&name, sizeof(EventRecord), dish_type.data(), dish_type.size());
+      }
+      dish_id = iter->second;
+    }
+    EventRecord record{timestamp_ms, duration, dish_id, worker, kind};
+    Append(&record, sizeof(EventRecord), NULL, 0);
+  }
+
+private:
+  static constexpr size_t kBufferSize = 1 << 20;
+
+  // Добавляет в буфер запись из заголовка и необязательного названия. Если
+  // буфер заполнен, ждет, пока фоновый поток его освободит.
+  void Append(const void* header, size_t header_size, const char* name, size_t name_size) {
+    const size_t size = header_size + name_size;
+    if (size > FrameHeader::kMaxFrameSize - sizeof(FrameHeader)) {
+      throw std::runtime_error("Too long dish type for binary log");
+    }
+    const uint64_t position = head.load(std::memory_order_relaxed);
+    while (position + size - tail.load(std::memory_order_acquire) > kBufferSize) {
+      std::this_thread::yield();
+    }
+    CopyIn(position, header, header_size);
+    CopyIn(position + header_size, name, name_size);
+    head.store(position + size, std::memory_order_release);
+  }
+
+  void CopyIn(uint64_t position, const void* data, size_t size) {
+    const size_t offset = position % kBufferSize;
+    const size_t first_part = std::min(size, kBufferSize - offset);
+    memcpy(buffer.data() + offset, data, first_part);
+    memcpy(buffer.data(), (const char*)data + first_part, size - first_part);
+  }
+
+  void CopyOut(uint64_t position, void* data, size_t size) {
+    const size_t offset = position % kBufferSize;
+    const size_t first_part = std::min(size, kBufferSize - offset);
+    memcpy(data, buffer.data() + offset, first_part);
+    memcpy((char*)data + first_part, buffer.data(), size - first_part);
+  }
+
+  // Функция фонового потока: собирает из буфера фреймы целых записей и пишет
+  // их в `fd`, пока не будет остановлен и не опустошит буфер.
+  void Drain() {
+    std::vector<char> frame(FrameHeader::kMaxFrameSize);
+    while (true) {
+      const bool stopping = stop.load(std::memory_order_acquire);
+      const uint64_t end = head.load(std::memory_order_acquire);
+      uint64_t position = tail.load(std::memory_order_relaxed);
+      if (position == end) {
+        if (stopping) {
+          return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        continue;
+      }
+      size_t frame_size = sizeof(FrameHeader);
+      while (position < end) {
+        EventRecord record;
+        CopyOut(position, &record, sizeof(EventRecord));
+        size_t record_size = sizeof(EventRecord);
+        if (record.kind == EventKind::DishName) {
+          record_size += record.duration;
+        }
+        if (frame_size + record_size > frame.size()) {
+          break;
+        }
+        CopyOut(position, frame.data() + frame_size, record_size);
+        frame_size += record_size;
+        position += record_size;
+      }
+      FrameHeader header{FrameHeader::kMagic, (uint32_t)(frame_size - sizeof(FrameHeader))};
+      memcpy(frame.data(), &header, sizeof(FrameHeader));
+      WriteAll(frame.data(), frame_size);
+      tail.store(position, std::memory_order_release);
+    }
+  }
+
+  void WriteAll(const char* data, size_t size) {
+    while (size > 0) {
+      ssize_t written = write(fd, data, size);
+      if (written == -1 && errno == EINTR) {
+        continue;
+      }
+      CheckResult(written, "write");
+      data += written;
+      size -= written;
+    }
+  }
+
+  WorkerId worker;
+  int fd;
+  // Идентификаторы посуды, уже переданные в лог. Используются только рабочим
+  // потоком.
+  std::unordered_map<std::string, uint16_t> dish_ids;
+  std::vector<char> buffer;
+  // Монотонно растущие позиции записи и чтения в кольцевом буфере.
+  std::atomic<uint64_t> head{0};
+  std::atomic<uint64_t> tail{0};
+  std::atomic<bool> stop{false};
+  std::thread writer;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Класс разделяемого состояния для мойщика и вытирателя, использующих
+// eventfd для своей коммуникации. Количество свободного места на столе и
+// количество вымытой посуды хранятся в счетчиках двух eventfd, созданных с
+// флагом `EFD_SEMAPHORE`: каждое чтение уменьшает счетчик на 1 и блокирует
+// процесс, если счетчик равен 0. Сами записи о посуде хранятся в кольцевом
+// буфере в анонимной разделяемой памяти, которая наследуется дочерним
+// процессом при `fork()`, поэтому ключ `ftok` не нужен.
+class EventfdSharedState : public SharedState {
+public:
+  EventfdSharedState(int table_limit) : table_limit(table_limit) {
+    dishes_fd = CheckResult(eventfd(0, EFD_SEMAPHORE), "eventfd");
+    remaining_space_fd = CheckResult(eventfd(table_limit, EFD_SEMAPHORE), "eventfd");
+    // Кольцевой буфер на `TABLE_LIMIT` записей: мойщик пишет в слот только
+    // после того, как получил свободное место, а вытиратель освобождает место
+    // только после того, как прочитал слот, поэтому дополнительный слот не
+    // нужен.
+    shm_size = table_limit * sizeof(DishType);
+    dishes = (DishType*)CheckResult(
+        mmap(NULL, shm_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0),
+        "mmap");
+  }
+
+  ~EventfdSharedState() override {
+    munmap(dishes, shm_size);
+    close(dishes_fd);
+    close(remaining_space_fd);
+  }
+
+  // Записывает данные о вымытой посуде в очередной слот кольцевого буфера.
+  // Блокирует выполнение, если на столе нет свободного места.
+  void PutDish(const std::string& dish_type, bool is_last) {
+    if (dish_type.size() >= sizeof(DishType::dish_type)) {
+      throw std::runtime_error("Too long dish type: " + dish_type);
+    }
+    // Ждем, пока на столе появится свободное место.
+    uint64_t value;
+    CheckResult(read(remaining_space_fd, &value, sizeof(uint64_t)), "read");
+    DishType& dish = dishes[head];
+    dish.last = is_last;
+    dish.size = dish_type.size();
+    memcpy(dish.dish_type, dish_type.data(), dish.size);
+    head = (head + 1) % table_limit;
+    // Сообщаем вытирателю о появлении посуды на столе.
+    value = 1;
+    CheckResult(write(dishes_fd, &value, sizeof(uint64_t)), "write");
+  }
+
+  // Читает данные о вымытой посуде из очередного слота кольцевого буфера.
+  // Блокирует выполнение, если на столе нет посуды.
+  std::string TakeDish(bool& is_last) {
+    // Ждем, пока на столе появится посуда.
+    uint64_t value;
+    CheckResult(read(dishes_fd, &value, sizeof(uint64_t)), "read");
+    const DishType& dish = dishes[tail];
+    is_last = dish.last;
+    std::string dish_type(dish.dish_type, dish.size);
+    tail = (tail + 1) % table_limit;
+    // Освобождаем место на столе.
+    value = 1;
+    CheckResult(write(remaining_space_fd, &value, sizeof(uint64_t)), "write");
+    return dish_type;
+  }
+
+private:
+  // Структура записи о посуде.
+  struct DishType {
+    bool last;
+    int size;
+    char dish_type[256];
+  };
+
+  int table_limit;
+  // eventfd, счетчик которого равен количеству вымытой посуды на столе.
+  int dishes_fd;
+  // eventfd, счетчик которого равен количеству свободного места на столе.
+  int remaining_space_fd;
+  size_t shm_size;
+  DishType* dishes;
+  // Индексы очередного слота для записи и для чтения. Каждый из них
+  // используется только одним процессом, поэтому хранится в его собственной
+  // памяти.
+  int head = 0;
+  int tail = 0;
+};
+
+// Класс мойщика, использующего в своей реализации eventfd и разделяемую
+// память.
+class EventfdWasher : public Washer {
+public:
+  EventfdWasher(const Times& washing_times, std::shared_ptr<EventfdSharedState> shared_state)
+    : Washer(washing_times), shared_state(shared_state) {}
+
+private:
+  void BeforeWork() override {}
+
+  void AfterWork() override {}
+
+  void PutDish(const std::string& dish_type, bool is_last) override {
+    shared_state->PutDish(dish_type, is_last);
+  }
+
+private:
+  std::shared_ptr<EventfdSharedState> shared_state;
+};
+
+// Класс вытирателя, использующего в своей реализации eventfd и разделяемую
+// память.
+class EventfdWiper : public Wiper {
+public:
+  EventfdWiper(const Times& wiping_times, std::shared_ptr<EventfdSharedState> shared_state)
+    : Wiper(wiping_times), shared_state(shared_state) {}
+
+private:
+  void BeforeWork() override {}
+
+  void AfterWork() override {}
+
+  bool IsWorkDone() override {
+    return took_last;
+  }
+
+  std::string TakeDish() override {
+    return shared_state->TakeDish(took_last);
+  }
+
+private:
+  std::shared_ptr<EventfdSharedState> shared_state;
+  bool took_last = false;
+};
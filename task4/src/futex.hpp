@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+
+// Считающий семафор на futex, предназначенный для размещения в разделяемой
+// между процессами памяти. В отличие от семафоров System V, не требует
+// ключей IPC и освобождается вместе с памятью, в которой лежит. Если
+// семафор не пуст и его никто не ждет, операции не делают системных вызовов.
+struct FutexSemaphore {
+  FutexSemaphore(uint32_t initial_value) : value(initial_value), waiters(0) {}
+
+  // Увеличивает значение семафора и будит один ожидающий процесс, если
+  // такой есть.
+  void Post() {
+    value.fetch_add(1);
+    if (waiters.load() > 0) {
+      Futex(FUTEX_WAKE, 1);
+    }
+  }
+
+  // Пытается уменьшить значение семафора без блокировки. Возвращает false,
+  // если значение равно 0.
+  bool TryWait() {
+    uint32_t current = value.load(std::memory_order_relaxed);
+    while (current > 0) {
+      if (value.compare_exchange_weak(current, current - 1, std::memory_order_acquire)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Уменьшает значение семафора, блокируя выполнение, пока оно равно 0.
+  void Wait() {
+    while (!TryWait()) {
+      // Счетчик ожидающих увеличивается до проверки значения в ядре, поэтому
+      // `Post()`, увеличивший значение после нашей проверки, обязательно
+      // увидит ожидающего и разбудит его.
+      waiters.fetch_add(1);
+      int result = Futex(FUTEX_WAIT, 0);
+      waiters.fetch_sub(1);
+      if (result == -1 && errno != EAGAIN && errno != EINTR) {
+        CheckResult(result, "futex");
+      }
+    }
+  }
+
+  // Возвращает текущее значение семафора.
+  uint32_t Value() const {
+    return value.load(std::memory_order_relaxed);
+  }
+
+private:
+  // Флаг `FUTEX_PRIVATE_FLAG` не используется, так как семафор разделяется
+  // между процессами.
+  int Futex(int op, uint32_t val) {
+    return syscall(SYS_futex, (uint32_t*)&value, op, val, NULL, NULL, 0);
+  }
+
+  static_assert(std::atomic<uint32_t>::is_always_lock_free);
+
+  std::atomic<uint32_t> value;
+  std::atomic<uint32_t> waiters;
+};
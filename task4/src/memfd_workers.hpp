@@ -0,0 +1,190 @@
+#pragma once
+
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "futex.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Участок разделяемой памяти, созданный через `memfd_create()` и
+// отображенный с флагом `MAP_SHARED`. Отображение наследуется дочерним
+// процессом при `fork()`, а сам файл не имеет имени в файловой системе и
+// ключа IPC, поэтому несколько конвейеров могут работать одновременно в
+// одной директории, а при аварийном завершении память освобождается вместе
+// с процессами.
+class SharedMemory {
+public:
+  // Если `huge_pages` истинно, память выделяется огромными страницами. Если
+  // выделить огромные страницы не удалось (например, они не
+  // зарезервированы в системе), используются обычные страницы.
+  SharedMemory(size_t size, bool huge_pages) {
+    if (huge_pages) {
+      try {
+        Map(RoundUp(size, kHugePageSize), MFD_HUGETLB);
+        return;
+      }
+      catch (const std::runtime_error& error) {
+        std::cerr << "Couldn't allocate huge pages, using regular pages: " << error.what()
+                  << std::endl;
+      }
+    }
+    Map(size, 0);
+  }
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  ~SharedMemory() {
+    munmap(addr, size);
+  }
+
+  char* Data() { return addr; }
+
+private:
+  static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+  static size_t RoundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+
+  void Map(size_t map_size, unsigned flags) {
+    int fd = CheckResult(memfd_create("dish_washing", MFD_CLOEXEC | flags), "memfd_create");
+    try {
+      CheckResult(ftruncate(fd, map_size), "ftruncate");
+      // Для hugetlbfs `mmap()` завершается ошибкой, если страниц не хватает,
+      // поэтому заполнение страниц при отображении позволяет сразу перейти
+      // к запасному варианту.
+      addr = (char*)CheckResult(mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, fd, 0),
+                                "mmap");
+    }
+    catch (...) {
+      close(fd);
+      throw;
+    }
+    // Отображение остается действительным и после закрытия дескриптора.
+    close(fd);
+    size = map_size;
+  }
+
+  char* addr;
+  size_t size;
+};
+
+// Класс разделяемого состояния для мойщика и вытирателя, использующих
+// память из `memfd_create()`. Синхронизация выполняется семафорами на
+// futex, расположенными в той же памяти, что и кольцевой буфер записей о
+// посуде.
+class MemfdSharedState : public SharedState {
+public:
+  MemfdSharedState(int table_limit, bool huge_pages)
+    : table_limit(table_limit),
+      memory(sizeof(Table) + table_limit * sizeof(DishType), huge_pages) {
+    table = new (memory.Data()) Table(table_limit);
+    dishes = (DishType*)(memory.Data() + sizeof(Table));
+  }
+
+  // Записывает данные о вымытой посуде в очередной слот кольцевого буфера.
+  // Блокирует выполнение, если на столе нет свободного места.
+  void PutDish(const std::string& dish_type, bool is_last) {
+    if (dish_type.size() >= sizeof(DishType::dish_type)) {
+      throw std::runtime_error("Too long dish type: " + dish_type);
+    }
+    table->remaining_space.Wait();
+    DishType& dish = dishes[head];
+    dish.last = is_last;
+    dish.size = dish_type.size();
+    memcpy(dish.dish_type, dish_type.data(), dish.size);
+    head = (head + 1) % table_limit;
+    table->dishes.Post();
+  }
+
+  // Читает данные о вымытой посуде из очередного слота кольцевого буфера.
+  // Блокирует выполнение, если на столе нет посуды.
+  std::string TakeDish(bool& is_last) {
+    table->dishes.Wait();
+    const DishType& dish = dishes[tail];
+    is_last = dish.last;
+    std::string dish_type(dish.dish_type, dish.size);
+    tail = (tail + 1) % table_limit;
+    table->remaining_space.Post();
+    return dish_type;
+  }
+
+private:
+  // Заголовок разделяемой памяти.
+  struct Table {
+    Table(int table_limit) : dishes(0), remaining_space(table_limit) {}
+
+    // Семафор, значение которого равно количеству вымытой посуды на столе.
+    FutexSemaphore dishes;
+    // Семафор, значение которого равно количеству свободного места на столе.
+    FutexSemaphore remaining_space;
+  };
+
+  // Структура записи о посуде.
+  struct DishType {
+    bool last;
+    int size;
+    char dish_type[256];
+  };
+
+  int table_limit;
+  SharedMemory memory;
+  Table* table;
+  DishType* dishes;
+  // Индексы очередного слота для записи и для чтения. Каждый из них
+  // используется только одним процессом.
+  int head = 0;
+  int tail = 0;
+};
+
+// Класс мойщика, использующего в своей реализации память из
+// `memfd_create()` и семафоры на futex.
+class MemfdWasher : public Washer {
+public:
+  MemfdWasher(const Times& washing_times, std::shared_ptr<MemfdSharedState> shared_state)
+    : Washer(washing_times), shared_state(shared_state) {}
+
+private:
+  void BeforeWork() override {}
+
+  void AfterWork() override {}
+
+  void PutDish(const std::string& dish_type, bool is_last) override {
+    shared_state->PutDish(dish_type, is_last);
+  }
+
+private:
+  std::shared_ptr<MemfdSharedState> shared_state;
+};
+
+// Класс вытирателя, использующего в своей реализации память из
+// `memfd_create()` и семафоры на futex.
+class MemfdWiper : public Wiper {
+public:
+  MemfdWiper(const Times& wiping_times, std::shared_ptr<MemfdSharedState> shared_state)
+    : Wiper(wiping_times), shared_state(shared_state) {}
+
+private:
+  void BeforeWork() override {}
+
+  void AfterWork() override {}
+
+  bool IsWorkDone() override {
+    return took_last;
+  }
+
+  std::string TakeDish() override {
+    return shared_state->TakeDish(took_last);
+  }
+
+private:
+  std::shared_ptr<MemfdSharedState> shared_state;
+  bool took_last = false;
+};
@@ -1,19 +1,35 @@
 #pragma once
 
+#include <algorithm>
+#include <fstream>
+
 #include "utils.hpp"
 #include "workers.hpp"
 
+// Пробуем увеличить буфер pipe до `size` байт (но не больше, чем позволяет
+// система), чтобы в нем помещался весь стол. Если это не удастся, мойщик
+// будет ждать в `write()`, пока вытиратель прочитает данные.
+inline void GrowPipe(int fd, long size) {
+  long max_size = 1 << 20;
+  std::ifstream("/proc/sys/fs/pipe-max-size") >> max_size;
+  fcntl(fd, F_SETPIPE_SZ, (int)std::min(size, max_size));
+}
+
 // Класс разделяемого состояния для мойщика и вытирателя, использующих pipe'ы
 // для своей коммуникации.
 class PipeSharedState : public SharedState {
 public:
-  PipeSharedState(int table_limit) {
+  PipeSharedState(int table_limit, size_t payload_size = 0) : payload_size(payload_size) {
     // Создаем два pipe: первый будет передавать данные о посуде, второй будет
     // передавать данные о свободном месте на столе (количество непрочитанные
     // байтов в pipe = количество свободного места).
     pipe_fds.resize(4);
     CheckResult(pipe(pipe_fds.data()), "pipe");
     CheckResult(pipe(pipe_fds.data() + 2), "pipe");
+    if (payload_size > 0) {
+      GrowPipe(DishesPipeWriteEnd(),
+               table_limit * (payload_size + sizeof(bool) + sizeof(int) + 256));
+    }
     // Заполняем второй pipe текущим количеством свободных мест.
     std::vector<char> table_spare_space(table_limit, 0);
     CheckResult(write(RemainingSpaceWriteEnd(), table_spare_space.data(), table_limit), "write");
@@ -24,6 +40,9 @@ public:
   int RemainingSpaceReadEnd() { return pipe_fds[2]; }
   int RemainingSpaceWriteEnd() { return pipe_fds[3]; }
 
+  // Размер полезной нагрузки, передаваемой с каждой посудой.
+  const size_t payload_size;
+
 private:
   std::vector<int> pipe_fds;
 };
@@ -32,7 +51,7 @@ private:
 class PipeWasher : public Washer {
 public:
   PipeWasher(const Times& washing_times, std::shared_ptr<PipeSharedState> shared_state)
-    : Washer(washing_times), shared_state(shared_state) {}
+    : Washer(washing_times), shared_state(shared_state), payload(shared_state->payload_size) {}
 
   ~PipeWasher() override {
     // Закрываем оставшиеся концы pipe. Делаем это в деструкторе, а не в
@@ -62,19 +81,27 @@ private:
     int size = dish_type.size();
     CheckResult(write(shared_state->DishesPipeWriteEnd(), &size, sizeof(int)), "write");
     CheckResult(write(shared_state->DishesPipeWriteEnd(), dish_type.data(), size), "write");
+    // Следом записываем полезную нагрузку посуды. Она копируется в буфер pipe
+    // при записи и еще раз при чтении вытирателем.
+    if (!payload.empty()) {
+      FillPayload(payload.data(), payload.size(), dishes_put++);
+      WriteAll(shared_state->DishesPipeWriteEnd(), payload.data(), payload.size());
+    }
   }
 
   void AfterWork() override {}
 
 private:
   std::shared_ptr<PipeSharedState> shared_state;
+  std::vector<char> payload;
+  uint64_t dishes_put = 0;
 };
 
 // Класс вытирателя, использующего в своей реализации pipe'ы.
 class PipeWiper : public Wiper {
 public:
   PipeWiper(const Times& wiping_times, std::shared_ptr<PipeSharedState> shared_state)
-    : Wiper(wiping_times), shared_state(shared_state) {}
+    : Wiper(wiping_times), shared_state(shared_state), payload(shared_state->payload_size) {}
 
 private:
   void BeforeWork() override {
@@ -94,6 +121,10 @@ private:
     CheckResult(read(shared_state->DishesPipeReadEnd(), &size, sizeof(int)), "read");
     std::string dish_type(size, 0);
     CheckResult(read(shared_state->DishesPipeReadEnd(), dish_type.data(), size), "read");
+    if (!payload.empty()) {
+      ReadAll(shared_state->DishesPipeReadEnd(), payload.data(), payload.size());
+      CheckPayload(payload.data(), payload.size(), dishes_taken++);
+    }
     // Добавляем одно свободное место на стол.
     bool byte;
     CheckResult(write(shared_state->RemainingSpaceWriteEnd(), &byte, sizeof(bool)), "write");
@@ -111,4 +142,6 @@ private:
 private:
   std::shared_ptr<PipeSharedState> shared_state;
   bool took_last = false;
+  std::vector<char> payload;
+  uint64_t dishes_taken = 0;
 };
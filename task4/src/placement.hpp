@@ -0,0 +1,158 @@
+#pragma once
+
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sched.h>
+
+#include "utils.hpp"
+
+// Взаимное расположение процессов мойщика и вытирателя на процессорах.
+enum struct Placement {
+  // Процессы не привязываются к процессорам.
+  Any,
+  // Оба процесса работают на одном логическом процессоре.
+  SameCore,
+  // Процессы работают на двух логических процессорах (SMT) одного ядра.
+  SmtSibling,
+  // Процессы работают на разных ядрах с общим кэшем последнего уровня.
+  SameLlc,
+  // Процессы работают на разных процессорных сокетах.
+  CrossSocket,
+};
+
+// Разбирает значение переменной среды PLACEMENT.
+inline Placement ParsePlacement(const std::string& value) {
+  if (value == "any") {
+    return Placement::Any;
+  }
+  if (value == "same-core") {
+    return Placement::SameCore;
+  }
+  if (value == "smt") {
+    return Placement::SmtSibling;
+  }
+  if (value == "llc") {
+    return Placement::SameLlc;
+  }
+  if (value == "cross-socket") {
+    return Placement::CrossSocket;
+  }
+  throw std::runtime_error("Unexpected placement: " + value);
+}
+
+// Топология логических процессоров, доступных текущему процессу. Данные
+// читаются из `/sys/devices/system/cpu`.
+class CpuTopology {
+public:
+  static CpuTopology Load() {
+    cpu_set_t allowed;
+    CheckResult(sched_getaffinity(0, sizeof(cpu_set_t), &allowed), "sched_getaffinity");
+
+    CpuTopology topology;
+    for (int cpu : ParseCpuList(ReadFile("/sys/devices/system/cpu/online"))) {
+      if (!CPU_ISSET(cpu, &allowed)) {
+        continue;
+      }
+      const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+      Cpu info;
+      info.id = cpu;
+      info.package = std::stoi(ReadFile(path + "/topology/physical_package_id"));
+      for (int sibling : ParseCpuList(ReadFile(path + "/topology/thread_siblings_list"))) {
+        info.siblings.insert(sibling);
+      }
+      // Кэш последнего уровня - кэш с наибольшим уровнем среди описанных.
+      int llc_level = -1;
+      for (int index = 0;; ++index) {
+        const std::string cache = path + "/cache/index" + std::to_string(index);
+        std::ifstream level_reader(cache + "/level");
+        int level;
+        if (!(level_reader >> level)) {
+          break;
+        }
+        if (level > llc_level) {
+          llc_level = level;
+          info.llc.clear();
+          for (int shared : ParseCpuList(ReadFile(cache + "/shared_cpu_list"))) {
+            info.llc.insert(shared);
+          }
+        }
+      }
+      topology.cpus.push_back(info);
+    }
+    return topology;
+  }
+
+  // Возвращает пару логических процессоров (для мойщика и для вытирателя),
+  // удовлетворяющую `placement`. Бросает исключение, если на машине нет
+  // подходящих процессоров.
+  std::pair<int, int> ChooseCpus(Placement placement) const {
+    for (const Cpu& first : cpus) {
+      if (placement == Placement::SameCore) {
+        return {first.id, first.id};
+      }
+      for (const Cpu& second : cpus) {
+        if (first.id == second.id) {
+          continue;
+        }
+        const bool smt_siblings = first.siblings.count(second.id) > 0;
+        const bool same_llc = first.llc.count(second.id) > 0;
+        if ((placement == Placement::SmtSibling && smt_siblings)
+            || (placement == Placement::SameLlc && !smt_siblings && same_llc)
+            || (placement == Placement::CrossSocket && first.package != second.package)) {
+          return {first.id, second.id};
+        }
+      }
+    }
+    throw std::runtime_error("Requested placement is not possible on this machine");
+  }
+
+private:
+  struct Cpu {
+    int id;
+    int package;
+    // Логические процессоры того же ядра (включая этот).
+    std::set<int> siblings;
+    // Логические процессоры, разделяющие с этим кэш последнего уровня.
+    std::set<int> llc;
+  };
+
+  static std::string ReadFile(const std::string& path) {
+    std::ifstream reader(path);
+    std::string content;
+    if (!std::getline(reader, content)) {
+      throw std::runtime_error("Couldn't read file " + path);
+    }
+    return content;
+  }
+
+  // Разбирает список процессоров в формате `0-3,8,10-11`.
+  static std::vector<int> ParseCpuList(const std::string& list) {
+    std::vector<int> result;
+    std::istringstream reader(list);
+    std::string range;
+    while (std::getline(reader, range, ',')) {
+      const size_t dash = range.find('-');
+      const int first = std::stoi(range.substr(0, dash));
+      const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; ++cpu) {
+        result.push_back(cpu);
+      }
+    }
+    return result;
+  }
+
+  std::vector<Cpu> cpus;
+};
+
+// Привязывает текущий процесс к логическому процессору `cpu`.
+inline void BindToCpu(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  CheckResult(sched_setaffinity(0, sizeof(cpu_set_t), &set), "sched_setaffinity");
+}
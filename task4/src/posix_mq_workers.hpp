@@ -0,0 +1,197 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <mqueue.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Класс разделяемого состояния для мойщика и вытирателя, использующих
+// очереди сообщений POSIX. Используются две очереди: в первой передаются
+// сообщения с записями о посуде (до `batch` посуд в одном сообщении), во
+// второй - сообщения со свободным местом на столе (кредитами), каждое из
+// которых несет несколько мест. Очереди удаляются из файловой системы сразу
+// после открытия и доступны работникам только через унаследованные при
+// `fork()` дескрипторы, поэтому не остаются в системе после аварийного
+// завершения.
+class PosixMqSharedState : public SharedState {
+public:
+  // Наибольшее количество посуды в одном сообщении, при котором размер
+  // сообщения не превышает ограничение по умолчанию `msgsize_max` (8192).
+  static constexpr int kMaxBatch = 31;
+  // Размер записи о посуде в сообщении: флаг последней посуды, длина
+  // названия и название.
+  static constexpr size_t kRecordSize = 2 + 255;
+
+  PosixMqSharedState(int table_limit, int batch, int credit_window)
+    : batch(batch), credit_window(credit_window) {
+    if (batch < 1 || batch > kMaxBatch) {
+      throw std::runtime_error("MQ_BATCH should be between 1 and " + std::to_string(kMaxBatch));
+    }
+    if (credit_window < 1) {
+      throw std::runtime_error("MQ_CREDIT_WINDOW should be positive");
+    }
+    const std::string prefix = "/dish_washing_" + std::to_string(getpid());
+    dishes_mq = Open(prefix + "_dishes", O_RDWR, MessageSize());
+    const std::string credits_name = prefix + "_credits";
+    credits_mq = Open(credits_name, O_RDWR, sizeof(int));
+    // Вытиратель возвращает кредиты без блокировки (см. `FlushCredits()`),
+    // поэтому для него открываем вторую копию дескриптора с `O_NONBLOCK`.
+    credits_nonblock_mq = CheckResult(mq_open(credits_name.c_str(), O_WRONLY | O_NONBLOCK), "mq_open");
+    CheckResult(mq_unlink((prefix + "_dishes").c_str()), "mq_unlink");
+    CheckResult(mq_unlink(credits_name.c_str()), "mq_unlink");
+    // Пишем сообщение о количестве свободного места на столе.
+    CheckResult(mq_send(credits_mq, (const char*)&table_limit, sizeof(int), 0), "mq_send");
+  }
+
+  ~PosixMqSharedState() override {
+    mq_close(dishes_mq);
+    mq_close(credits_mq);
+    mq_close(credits_nonblock_mq);
+  }
+
+  size_t MessageSize() const { return 1 + batch * kRecordSize; }
+
+  mqd_t DishesMq() { return dishes_mq; }
+  mqd_t CreditsMq() { return credits_mq; }
+  mqd_t CreditsNonblockMq() { return credits_nonblock_mq; }
+
+  const int batch;
+  const int credit_window;
+
+private:
+  static mqd_t Open(const std::string& name, int flags, size_t message_size) {
+    mq_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    // Ограничение по умолчанию `msg_max` для непривилегированных процессов.
+    attr.mq_maxmsg = 10;
+    attr.mq_msgsize = message_size;
+    return CheckResult(mq_open(name.c_str(), flags | O_CREAT | O_EXCL, 0600, &attr), "mq_open");
+  }
+
+  mqd_t dishes_mq;
+  mqd_t credits_mq;
+  mqd_t credits_nonblock_mq;
+};
+
+// Класс мойщика, использующего очереди сообщений POSIX. Мойщик копит
+// вымытую посуду в сообщении и отправляет его, когда в нем набирается
+// `batch` посуд, когда посуда последняя или когда мойщику нужно ждать
+// кредитов (иначе вытиратель мог бы не получить посуду, за которую должен
+// вернуть кредиты).
+class PosixMqWasher : public Washer {
+public:
+  PosixMqWasher(const Times& washing_times, std::shared_ptr<PosixMqSharedState> shared_state)
+    : Washer(washing_times), shared_state(shared_state), message(shared_state->MessageSize()) {}
+
+private:
+  void BeforeWork() override {}
+
+  void PutDish(const std::string& dish_type, bool is_last) override {
+    if (dish_type.size() > PosixMqSharedState::kRecordSize - 2) {
+      throw std::runtime_error("Too long dish type: " + dish_type);
+    }
+    if (credits == 0) {
+      // Ждем, пока появится свободное место на столе.
+      Flush();
+      int count;
+      CheckResult(mq_receive(shared_state->CreditsMq(), (char*)&count, sizeof(int), NULL), "mq_receive");
+      credits += count;
+    }
+    --credits;
+    // Добавляем запись о посуде в сообщение.
+    message[size++] = is_last;
+    message[size++] = dish_type.size();
+    memcpy(message.data() + size, dish_type.data(), dish_type.size());
+    size += dish_type.size();
+    ++message[0];
+    if (message[0] == shared_state->batch || is_last) {
+      Flush();
+    }
+  }
+
+  void AfterWork() override {}
+
+  // Отправляет накопленные записи о посуде.
+  void Flush() {
+    if (message[0] == 0) {
+      return;
+    }
+    CheckResult(mq_send(shared_state->DishesMq(), message.data(), size, 0), "mq_send");
+    message[0] = 0;
+    size = 1;
+  }
+
+private:
+  std::shared_ptr<PosixMqSharedState> shared_state;
+  // Количество свободных мест на столе, полученных мойщиком.
+  int credits = 0;
+  // Сообщение с записями о посуде: первый байт - количество записей.
+  std::vector<char> message;
+  size_t size = 1;
+};
+
+// Класс вытирателя, использующего очереди сообщений POSIX. Вытиратель
+// возвращает кредиты пачками по `credit_window` мест, а перед тем как
+// заблокироваться в ожидании посуды, возвращает все накопленные кредиты.
+class PosixMqWiper : public Wiper {
+public:
+  PosixMqWiper(const Times& wiping_times, std::shared_ptr<PosixMqSharedState> shared_state)
+    : Wiper(wiping_times), shared_state(shared_state), message(shared_state->MessageSize()) {}
+
+private:
+  void BeforeWork() override {}
+
+  bool IsWorkDone() override { return took_last; }
+
+  std::string TakeDish() override {
+    if (taken == message[0]) {
+      // Записи из полученного сообщения закончились - ждем следующего.
+      FlushCredits();
+      CheckResult(mq_receive(shared_state->DishesMq(), message.data(), message.size(), NULL), "mq_receive");
+      taken = 0;
+      position = 1;
+    }
+    took_last = message[position++];
+    const size_t dish_size = (unsigned char)message[position++];
+    std::string dish_type(message.data() + position, dish_size);
+    position += dish_size;
+    ++taken;
+    if (++pending_credits >= shared_state->credit_window) {
+      FlushCredits();
+    }
+    return dish_type;
+  }
+
+  void AfterWork() override {}
+
+  // Возвращает накопленные кредиты. Если очередь кредитов заполнена, у мойщика
+  // уже есть свободные места, и кредиты будут отправлены при следующем вызове.
+  void FlushCredits() {
+    if (pending_credits == 0) {
+      return;
+    }
+    if (mq_send(shared_state->CreditsNonblockMq(), (const char*)&pending_credits, sizeof(int), 0) == -1) {
+      if (errno != EAGAIN) {
+        CheckResult(-1, "mq_send");
+      }
+      return;
+    }
+    pending_credits = 0;
+  }
+
+private:
+  std::shared_ptr<PosixMqSharedState> shared_state;
+  bool took_last = false;
+  // Последнее полученное сообщение с записями о посуде, количество уже
+  // взятых из него записей и позиция следующей записи.
+  std::vector<char> message;
+  int taken = 0;
+  size_t position = 1;
+  // Количество взятой со стола посуды, за которую еще не возвращены кредиты.
+  int pending_credits = 0;
+};
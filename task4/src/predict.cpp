@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "utils.hpp"
+
+// Программа, аналитически вычисляющая время работы мойки без запуска
+// работников. Моменты событий вычисляются по рекуррентным соотношениям в
+// (max, +)-алгебре для i-й посуды при размере стола N:
+//   W[i] = P[i-1] + wash[i]        - мойщик домыл посуду,
+//   P[i] = max(W[i], T[i-N])       - мойщик поставил посуду на стол, когда
+//                                    вытиратель забрал посуду i-N,
+//   T[i] = max(P[i], F[i-1])       - вытиратель взял посуду со стола,
+//   F[i] = T[i] + wipe[i]          - вытиратель вытер посуду,
+// где P[0] = F[0] = 0 и T[j] = 0 при j <= 0. Время работы равно F[n].
+//
+// Параметры: `predict <washing-times> <wiping-times> <dishes> [throughput]`.
+// Если задана переменная среды TABLE_LIMIT, программа выводит прогноз для
+// стола этого размера. Если задана целевая пропускная способность (посуда
+// в секунду), программа находит наименьший размер стола, при котором она
+// достигается.
+
+namespace {
+
+// Подряд идущая посуда одного типа из списка посуды.
+struct Run {
+  int64_t wash;
+  int64_t wipe;
+  int64_t count;
+};
+
+struct Prediction {
+  int64_t dishes = 0;
+  int64_t makespan = 0;
+  // Время окончания работы мойщика.
+  int64_t washer_finish = 0;
+  int64_t washer_busy = 0;
+  // Суммарное время ожидания мойщиком свободного места на столе.
+  int64_t washer_stall = 0;
+  int64_t wiper_busy = 0;
+  // Суммарное время ожидания вытирателем посуды на столе.
+  int64_t wiper_idle = 0;
+
+  double Throughput() const {
+    return makespan == 0 ? 0 : (double)dishes / makespan;
+  }
+};
+
+std::vector<Run> LoadRuns(const Times& washing_times, const Times& wiping_times,
+                          WashTaskQueue queue) {
+  std::vector<Run> runs;
+  while (!queue.empty()) {
+    const WashTask& task = queue.front();
+    if (task.count > 0) {
+      runs.push_back({washing_times.at(task.dish_type), wiping_times.at(task.dish_type), task.count});
+    }
+    queue.pop();
+  }
+  return runs;
+}
+
+// Вычисляет прогноз для стола размера `table_limit` за один проход по
+// посуде. Хранятся только моменты T последних `table_limit` посуд.
+Prediction Predict(const std::vector<Run>& runs, int64_t table_limit) {
+  Prediction result;
+  int64_t total = 0;
+  for (const Run& run : runs) {
+    total += run.count;
+  }
+  // Если стол вмещает всю посуду, мойщик никогда не ждет.
+  const int64_t history_size = std::min(table_limit, total);
+  std::vector<int64_t> taken(std::max<int64_t>(history_size, 1), 0);
+
+  int64_t put = 0;
+  int64_t finished = 0;
+  // Слот истории, хранящий момент T посуды i-N. До заполнения истории
+  // в слотах лежат нули.
+  size_t slot_index = 0;
+  for (const Run& run : runs) {
+    for (int64_t k = 0; k < run.count; ++k) {
+      const int64_t washed = put + run.wash;
+      int64_t& slot = taken[slot_index];
+      if (++slot_index == taken.size()) {
+        slot_index = 0;
+      }
+      const int64_t space_freed = slot;
+      put = std::max(washed, space_freed);
+      const int64_t take = std::max(put, finished);
+      result.washer_stall += put - washed;
+      result.wiper_idle += take - finished;
+      result.washer_busy += run.wash;
+      result.wiper_busy += run.wipe;
+      finished = take + run.wipe;
+      slot = take;
+    }
+  }
+  result.dishes = total;
+  result.washer_finish = put;
+  result.makespan = finished;
+  return result;
+}
+
+void PrintPrediction(const Prediction& prediction, int64_t table_limit) {
+  std::cout << "Table limit: " << table_limit << "\n"
+            << "Dishes: " << prediction.dishes << "\n"
+            << "Makespan: " << prediction.makespan << " sec\n"
+            << "Throughput: " << std::setprecision(6) << prediction.Throughput() << " dishes/sec\n"
+            << "WASHER busy " << prediction.washer_busy << " sec, table-full stall "
+            << prediction.washer_stall << " sec, finished at " << prediction.washer_finish << " sec\n"
+            << "WIPER  busy " << prediction.wiper_busy << " sec, idle " << prediction.wiper_idle
+            << " sec, finished at " << prediction.makespan << " sec" << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc != 4 && argc != 5) {
+    throw std::runtime_error("Incorrect number of arguments");
+  }
+  Times washing_times = Times::LoadFromFile(argv[1]);
+  Times wiping_times = Times::LoadFromFile(argv[2]);
+  const std::vector<Run> runs =
+      LoadRuns(washing_times, wiping_times, WashTaskQueue::LoadFromFile(argv[3]));
+
+  char* table_limit_var = getenv("TABLE_LIMIT");
+  if (table_limit_var == NULL && argc == 4) {
+    throw std::runtime_error("Either TABLE_LIMIT env variable or target throughput should be set");
+  }
+  if (table_limit_var != NULL) {
+    const int64_t table_limit = std::stoll(table_limit_var);
+    if (table_limit <= 0) {
+      throw std::runtime_error("TABLE_LIMIT should be positive");
+    }
+    PrintPrediction(Predict(runs, table_limit), table_limit);
+  }
+
+  if (argc == 5) {
+    const double target = std::stod(argv[4]);
+    // Время работы не растет с увеличением стола, а стол размером с
+    // количество посуды эквивалентен бесконечному, поэтому наименьший
+    // подходящий размер находится двоичным поиском.
+    int64_t low = 1;
+    int64_t high = 1;
+    for (const Run& run : runs) {
+      high += run.count;
+    }
+    if (Predict(runs, high).Throughput() < target) {
+      std::cout << "Target throughput " << target << " dishes/sec is not reachable, maximum is "
+                << Predict(runs, high).Throughput() << " dishes/sec" << std::endl;
+      return 1;
+    }
+    while (low < high) {
+      const int64_t middle = low + (high - low) / 2;
+      if (Predict(runs, middle).Throughput() >= target) {
+        high = middle;
+      }
+      else {
+        low = middle + 1;
+      }
+    }
+    std::cout << "Smallest table limit for " << target << " dishes/sec: " << low << "\n";
+    PrintPrediction(Predict(runs, low), low);
+  }
+  return 0;
+}
@@ -3,6 +3,7 @@
 #include <semaphore.h>
 #include <sys/shm.h>
 
+#include "adaptive_wait.hpp"
 #include "utils.hpp"
 #include "workers.hpp"
 
@@ -12,16 +13,19 @@
 // полей для хранения состояния очереди записей о посуде.
 // Этот класс инкапсулирует всю логику работы с разделяемой памятью от классов
 // работников.
+// Ожидание на семафорах выполняется согласно `wait_policy`: при коротких
+// временах мытья и вытирания процесс может дождаться посуды или места на
+// столе, прокрутившись в цикле, без двух переключений контекста на засыпание
+// в ядре.
 class ShmSharedState : public SharedState {
 public:
-  ShmSharedState(int table_limit) : table_limit(table_limit) {
+  ShmSharedState(int table_limit, const WaitPolicy& wait_policy = {})
+    : table_limit(table_limit), wait_policy(wait_policy) {
     // Инициализируем участок разделяемой памяти.
     key_t key = CheckResult(ftok(".", 0), "ftok");
     // `dishes_size` - количество записей о посуды, поставленной на стол,
-    // которое мы можем хранить в разделяемой памяти. Это значение на 1 больше,
-    // чем `TABLE_LIMIT`, так как `Washer` может записать данные о посуде, даже
-    // если стол заполнен, чтобы избежать гонки процессов.
-    dishes_size = table_limit + 1;
+    // которое мы можем хранить в разделяемой памяти.
+    dishes_size = table_limit;
     // Размер выделяемой памяти - метаданные + массив записей о посуде.
     int shm_size = sizeof(ShmMetadata) + dishes_size * sizeof(DishType);
     shm_id = CheckResult(shmget(key, shm_size, IPC_CREAT | IPC_EXCL | 0660), "shmget");
@@ -48,18 +52,19 @@ public:
   // нет свободного места.
   void PutDish(const std::string& dish_type, bool is_last) {
     // Ждем, пока на столе не будет свободного места.
-    CheckResult(sem_post(&shm_metadata->dishes_sem), "sem_post");
-    CheckResult(sem_wait(&shm_metadata->remaining_space_sem), "sem_wait");
+    Wait(&shm_metadata->remaining_space_sem);
     // Записываем данные в разделяемую память.
-    // Записанной посуды в разделяемую память может стать больше (на 1), чем
-    // размер стола `TABLE_LIMIT` (в методе `TakeDish()` увеличили значение
-    // семафора, указывающего на количество свободного места, но не успели
-    // прочитать данные, а в этом методе уже записываем новые), но мы это учли
-    // при инициализации разделяемой памяти.
-    shm_metadata->has_last_dish = is_last;
     shm_metadata->dishes_head = (shm_metadata->dishes_head + 1) % dishes_size;
     dishes[shm_metadata->dishes_head].size = dish_type.size();
     strcpy(dishes[shm_metadata->dishes_head].dish_type, dish_type.c_str());
+    // Флаг последней посуды читается в `IsAllDishesTaken()` без семафора,
+    // поэтому он выставляется только после записи слота: иначе вытиратель
+    // может увидеть флаг и еще пустой слот и завершиться, не вытерев
+    // последнюю посуду.
+    __atomic_store_n(&shm_metadata->has_last_dish, is_last, __ATOMIC_RELEASE);
+    // Сообщаем вытирателю о посуде только после того, как данные записаны,
+    // иначе он может прочитать еще не заполненный слот.
+    CheckResult(sem_post(&shm_metadata->dishes_sem), "sem_post");
   }
 
   // Читает данные о вымытой посуде из разделяемой памяти согласно положению
@@ -67,8 +72,7 @@ public:
   // данных.
   std::string TakeDish() {
     // Ждем, пока появятся данные.
-    CheckResult(sem_post(&shm_metadata->remaining_space_sem), "sem_post");
-    CheckResult(sem_wait(&shm_metadata->dishes_sem), "sem_wait");
+    Wait(&shm_metadata->dishes_sem);
     // Получаем данные.
     int size = dishes[shm_metadata->dishes_tail].size;
     if (size == 0) {
@@ -79,14 +83,33 @@ public:
     memcpy(dish_type.data(), dishes[shm_metadata->dishes_tail].dish_type, size);
     dishes[shm_metadata->dishes_tail].size = 0;
     shm_metadata->dishes_tail = (shm_metadata->dishes_tail + 1) % dishes_size;
+    // Освобождаем место на столе после того, как слот прочитан.
+    CheckResult(sem_post(&shm_metadata->remaining_space_sem), "sem_post");
     return dish_type;
   }
 
   bool IsAllDishesTaken() {
-    return shm_metadata->has_last_dish && dishes[shm_metadata->dishes_tail].size == 0;
+    return __atomic_load_n(&shm_metadata->has_last_dish, __ATOMIC_ACQUIRE) &&
+           dishes[shm_metadata->dishes_tail].size == 0;
+  }
+
+  // Выводит статистику ожиданий текущего процесса, если используется
+  // адаптивное ожидание.
+  void PrintWaitStats(const std::string& name) {
+    if (wait_policy.IsAdaptive()) {
+      wait_stats.Print(name);
+    }
   }
 
 private:
+  // Уменьшает значение семафора согласно `wait_policy`. `sem_trywait()` не
+  // делает системных вызовов, а `sem_wait()` засыпает на futex.
+  void Wait(sem_t* sem) {
+    AdaptiveWait(wait_policy, wait_stats,
+                 [sem]() { return sem_trywait(sem) == 0; },
+                 [sem]() { CheckResult(sem_wait(sem), "sem_wait"); });
+  }
+
   // Метаданные для синхронизации процессов мойщика и вытирателя.
   struct ShmMetadata {
     // Семафор, значение которого равно количеству вымытой посуды на столе.
@@ -113,6 +136,9 @@ private:
   };
 
   int table_limit;
+  WaitPolicy wait_policy;
+  // Статистика ожиданий. После `fork()` у каждого процесса своя копия.
+  WaitStats wait_stats;
   int dishes_size;
   int shm_id;
   char* shm_addr;
@@ -129,7 +155,9 @@ public:
 private:
   void BeforeWork() override {}
 
-  void AfterWork() override {}
+  void AfterWork() override {
+    shared_state->PrintWaitStats("WASHER");
+  }
 
   void PutDish(const std::string& dish_type, bool is_last) override {
     shared_state->PutDish(dish_type, is_last);
@@ -148,7 +176,9 @@ public:
 private:
   void BeforeWork() override {}
 
-  void AfterWork() override {}
+  void AfterWork() override {
+    shared_state->PrintWaitStats("WIPER ");
+  }
 
   bool IsWorkDone() override {
     return shared_state->IsAllDishesTaken();
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "pipe_workers.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Заголовок записи о посуде в pipe работников `splice`. Следом за заголовком
+// в pipe идет полезная нагрузка размером `payload_size`.
+struct SpliceDishHeader {
+  bool last;
+  // Индекс буфера мойщика, из которого передана полезная нагрузка.
+  int buffer_index;
+  int size;
+  char dish_type[256];
+};
+
+// Класс разделяемого состояния для мойщика и вытирателя, передающих полезную
+// нагрузку посуды без копирования при записи. Мойщик отдает страницы своих
+// буферов в pipe вызовом `vmsplice()` с флагом `SPLICE_F_GIFT`, поэтому данные
+// копируются только один раз - при чтении вытирателем. Через второй pipe
+// вытиратель возвращает индексы прочитанных буферов: пока индекс не
+// вернулся, страницы буфера могут быть еще в pipe, и мойщик не должен их
+// менять. Количество буферов равно размеру стола, поэтому возврат индекса
+// одновременно означает освобождение места на столе.
+class SpliceSharedState : public SharedState {
+public:
+  SpliceSharedState(int table_limit, size_t payload_size)
+    : table_limit(table_limit), payload_size(payload_size) {
+    pipe_fds.resize(4);
+    CheckResult(pipe(pipe_fds.data()), "pipe");
+    CheckResult(pipe(pipe_fds.data() + 2), "pipe");
+    // Емкость pipe считается в страницах: каждая посуда занимает страницу
+    // заголовка и страницы подаренного буфера.
+    const long page_size = sysconf(_SC_PAGESIZE);
+    GrowPipe(DishesPipeWriteEnd(),
+             table_limit * (1 + ((long)payload_size + page_size - 1) / page_size) * page_size);
+    // Все буферы мойщика изначально свободны.
+    for (int index = 0; index < table_limit; ++index) {
+      CheckResult(write(FreeBuffersWriteEnd(), &index, sizeof(int)), "write");
+    }
+  }
+
+  int DishesPipeReadEnd() { return pipe_fds[0]; }
+  int DishesPipeWriteEnd() { return pipe_fds[1]; }
+  int FreeBuffersReadEnd() { return pipe_fds[2]; }
+  int FreeBuffersWriteEnd() { return pipe_fds[3]; }
+
+  const int table_limit;
+  // Размер полезной нагрузки, передаваемой с каждой посудой.
+  const size_t payload_size;
+
+private:
+  std::vector<int> pipe_fds;
+};
+
+// Класс мойщика, передающего полезную нагрузку через `vmsplice()`.
+class SpliceWasher : public Washer {
+public:
+  SpliceWasher(const Times& washing_times, std::shared_ptr<SpliceSharedState> shared_state)
+    : Washer(washing_times), shared_state(shared_state) {}
+
+  ~SpliceWasher() override {
+    if (buffers != NULL) {
+      munmap(buffers, buffer_size * shared_state->table_limit);
+    }
+    // Как и у `PipeWasher`, закрываем оставшиеся концы pipe в деструкторе.
+    CheckResult(close(shared_state->DishesPipeWriteEnd()), "close");
+    CheckResult(close(shared_state->FreeBuffersReadEnd()), "close");
+  }
+
+private:
+  void BeforeWork() override {
+    CheckResult(close(shared_state->DishesPipeReadEnd()), "close");
+    CheckResult(close(shared_state->FreeBuffersWriteEnd()), "close");
+    // Буферы выделяются уже после `fork()`, чтобы запись в них не вызывала
+    // копирования страниц, общих с процессом вытирателя. Размер буфера
+    // округляется до целых страниц: подарить pipe можно только целые
+    // страницы, выровненные по границе страницы.
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    buffer_size = (shared_state->payload_size + page_size - 1) / page_size * page_size;
+    if (buffer_size > 0) {
+      buffers = (char*)CheckResult(
+          mmap(NULL, buffer_size * shared_state->table_limit, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0),
+          "mmap");
+    }
+  }
+
+  void PutDish(const std::string& dish_type, bool is_last) override {
+    if (dish_type.size() >= sizeof(SpliceDishHeader::dish_type)) {
+      throw std::runtime_error("Too long dish type: " + dish_type);
+    }
+    // Ждем, пока вытиратель вернет свободный буфер (и место на столе).
+    SpliceDishHeader header;
+    ReadAll(shared_state->FreeBuffersReadEnd(), &header.buffer_index, sizeof(int));
+    header.last = is_last;
+    header.size = dish_type.size();
+    memcpy(header.dish_type, dish_type.data(), dish_type.size());
+    WriteAll(shared_state->DishesPipeWriteEnd(), &header, sizeof(SpliceDishHeader));
+
+    if (shared_state->payload_size > 0) {
+      char* payload = buffers + header.buffer_index * buffer_size;
+      FillPayload(payload, shared_state->payload_size, dishes_put++);
+      iovec iov{payload, shared_state->payload_size};
+      while (iov.iov_len > 0) {
+        ssize_t spliced = CheckResult(
+            vmsplice(shared_state->DishesPipeWriteEnd(), &iov, 1, SPLICE_F_GIFT), "vmsplice");
+        iov.iov_base = (char*)iov.iov_base + spliced;
+        iov.iov_len -= spliced;
+      }
+    }
+  }
+
+  void AfterWork() override {}
+
+private:
+  std::shared_ptr<SpliceSharedState> shared_state;
+  // Буферы полезной нагрузки, по одному на место на столе.
+  char* buffers = NULL;
+  size_t buffer_size = 0;
+  uint64_t dishes_put = 0;
+};
+
+// Класс вытирателя, читающего полезную нагрузку, переданную через
+// `vmsplice()`.
+class SpliceWiper : public Wiper {
+public:
+  SpliceWiper(const Times& wiping_times, std::shared_ptr<SpliceSharedState> shared_state)
+    : Wiper(wiping_times), shared_state(shared_state), payload(shared_state->payload_size) {}
+
+private:
+  void BeforeWork() override {
+    CheckResult(close(shared_state->DishesPipeWriteEnd()), "close");
+    CheckResult(close(shared_state->FreeBuffersReadEnd()), "close");
+  }
+
+  bool IsWorkDone() override {
+    return took_last;
+  }
+
+  std::string TakeDish() override {
+    SpliceDishHeader header;
+    ReadAll(shared_state->DishesPipeReadEnd(), &header, sizeof(SpliceDishHeader));
+    took_last = header.last;
+    if (!payload.empty()) {
+      ReadAll(shared_state->DishesPipeReadEnd(), payload.data(), payload.size());
+      CheckPayload(payload.data(), payload.size(), dishes_taken++);
+    }
+    // Страницы буфера больше не нужны pipe - возвращаем буфер мойщику.
+    CheckResult(write(shared_state->FreeBuffersWriteEnd(), &header.buffer_index, sizeof(int)),
+                "write");
+    return std::string(header.dish_type, header.size);
+  }
+
+  void AfterWork() override {
+    CheckResult(close(shared_state->DishesPipeReadEnd()), "close");
+    CheckResult(close(shared_state->FreeBuffersWriteEnd()), "close");
+  }
+
+private:
+  std::shared_ptr<SpliceSharedState> shared_state;
+  bool took_last = false;
+  std::vector<char> payload;
+  uint64_t dishes_taken = 0;
+};
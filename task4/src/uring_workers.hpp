@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "pipe_workers.hpp"
+#include "utils.hpp"
+#include "workers.hpp"
+
+// Минимальная обертка над io_uring, использующая системные вызовы напрямую
+// (без liburing). Позволяет получать свободные SQE, отправлять их в ядро
+// одним вызовом `io_uring_enter()` и забирать CQE из очереди завершений.
+class IoUring {
+public:
+  IoUring(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = CheckResult(syscall(__NR_io_uring_setup, entries, &params), "io_uring_setup");
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+    sq_ring = (char*)CheckResult(mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING),
+                                 "mmap");
+    if (single_mmap) {
+      cq_ring = sq_ring;
+    }
+    else {
+      cq_ring = (char*)CheckResult(mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING),
+                                   "mmap");
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe*)CheckResult(mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES),
+                                      "mmap");
+
+    sq_head = (unsigned*)(sq_ring + params.sq_off.head);
+    sq_tail = (unsigned*)(sq_ring + params.sq_off.tail);
+    sq_mask = *(unsigned*)(sq_ring + params.sq_off.ring_mask);
+    sq_array = (unsigned*)(sq_ring + params.sq_off.array);
+    sq_entries = params.sq_entries;
+    cq_head = (unsigned*)(cq_ring + params.cq_off.head);
+    cq_tail = (unsigned*)(cq_ring + params.cq_off.tail);
+    cq_mask = *(unsigned*)(cq_ring + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe*)(cq_ring + params.cq_off.cqes);
+    local_sq_tail = *sq_tail;
+  }
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  ~IoUring() {
+    munmap(sqes, sqes_size);
+    if (cq_ring != sq_ring) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    munmap(sq_ring, sq_ring_size);
+    // Незавершенные запросы отменяются ядром при закрытии дескриптора.
+    close(fd);
+  }
+
+  // Возвращает true, если ядро поддерживает io_uring и операции
+  // `IORING_OP_READ`/`IORING_OP_WRITE`. Используется для выбора запасного
+  // варианта работников на старых ядрах или при отключенном io_uring.
+  static bool IsSupported() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring_fd = syscall(__NR_io_uring_setup, 1, &params);
+    if (ring_fd == -1) {
+      return false;
+    }
+    const size_t probe_size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+    std::vector<char> buffer(probe_size, 0);
+    io_uring_probe* probe = (io_uring_probe*)buffer.data();
+    bool supported = syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0
+        && probe->last_op >= IORING_OP_WRITE
+        && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+        && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+    close(ring_fd);
+    return supported;
+  }
+
+  // Добавляет в очередь запрос на чтение или запись `size` байт. Запрос будет
+  // отправлен в ядро следующим вызовом `Submit()`.
+  void PrepareRead(int file_fd, void* buffer, unsigned size, uint64_t user_data, bool link = false) {
+    Prepare(IORING_OP_READ, file_fd, buffer, size, user_data, link);
+  }
+  void PrepareWrite(int file_fd, const void* buffer, unsigned size, uint64_t user_data, bool link = false) {
+    Prepare(IORING_OP_WRITE, file_fd, buffer, size, user_data, link);
+  }
+
+  // Отправляет в ядро все подготовленные запросы и, если `wait_nr` больше 0,
+  // блокирует выполнение до появления как минимум `wait_nr` завершений.
+  void Submit(unsigned wait_nr) {
+    __atomic_store_n(sq_tail, local_sq_tail, __ATOMIC_RELEASE);
+    int result;
+    do {
+      result = syscall(__NR_io_uring_enter, fd, to_submit, wait_nr,
+                       wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (result == -1 && errno == EINTR);
+    to_submit -= CheckResult(result, "io_uring_enter");
+  }
+
+  // Извлекает очередное завершение в `cqe`. Возвращает false, если очередь
+  // завершений пуста.
+  bool PopCompletion(io_uring_cqe& cqe) {
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+      return false;
+    }
+    cqe = cqes[head & cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+private:
+  void Prepare(uint8_t opcode, int file_fd, const void* buffer, unsigned size,
+               uint64_t user_data, bool link) {
+    if (local_sq_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+      throw std::runtime_error("io_uring submission queue is full");
+    }
+    const unsigned index = local_sq_tail & sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(io_uring_sqe));
+    sqe->opcode = opcode;
+    sqe->fd = file_fd;
+    sqe->addr = (uint64_t)buffer;
+    sqe->len = size;
+    // Для pipe'ов смещение игнорируется, -1 означает текущую позицию.
+    sqe->off = (uint64_t)-1;
+    sqe->flags = link ? IOSQE_IO_LINK : 0;
+    sqe->user_data = user_data;
+    sq_array[index] = index;
+    ++local_sq_tail;
+    ++to_submit;
+  }
+
+  int fd;
+  char* sq_ring;
+  char* cq_ring;
+  io_uring_sqe* sqes;
+  size_t sq_ring_size;
+  size_t cq_ring_size;
+  size_t sqes_size;
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned sq_mask;
+  unsigned* sq_array;
+  unsigned sq_entries;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  unsigned cq_mask;
+  io_uring_cqe* cqes;
+  // Хвост очереди запросов, еще не опубликованный для ядра.
+  unsigned local_sq_tail;
+  // Количество подготовленных, но еще не отправленных запросов.
+  unsigned to_submit = 0;
+};
+
+// Запись о посуде, передаваемая через pipe работниками, использующими
+// io_uring. Все записи имеют одинаковый размер (меньше `PIPE_BUF`), поэтому
+// каждая запись пишется в pipe атомарно и каждое чтение размером с запись
+// получает ровно одну запись, даже если в полете несколько чтений.
+struct UringDishRecord {
+  // Порядковый номер посуды: завершения нескольких чтений могут прийти в
+  // произвольном порядке, по этому номеру вытиратель восстанавливает порядок,
+  // в котором посуда была поставлена на стол.
+  uint64_t seq;
+  bool last;
+  int size;
+  char dish_type[256];
+};
+
+// Проверяет результат завершенного запроса io_uring.
+inline int CheckCompletion(const io_uring_cqe& cqe, const std::string& operation) {
+  if (cqe.res < 0) {
+    throw std::runtime_error("Error while " + operation + ": " + strerror(-cqe.res));
+  }
+  return cqe.res;
+}
+
+// Класс мойщика, использующего pipe'ы через io_uring. Ожидание свободного
+// места на столе (чтение из pipe свободного места) и запись данных о посуде
+// отправляются в ядро одной связанной парой SQE, то есть одним системным
+// вызовом на посуду.
+class UringWasher : public Washer {
+public:
+  UringWasher(const Times& washing_times, std::shared_ptr<PipeSharedState> shared_state)
+    : Washer(washing_times), shared_state(shared_state) {}
+
+  ~UringWasher() override {
+    // Как и в `PipeWasher`, закрываем оставшиеся концы pipe'ов только после
+    // завершения работы обоих работников.
+    CheckResult(close(shared_state->DishesPipeWriteEnd()), "close");
+    CheckResult(close(shared_state->RemainingSpaceReadEnd()), "close");
+  }
+
+private:
+  void BeforeWork() override {
+    CheckResult(close(shared_state->DishesPipeReadEnd()), "close");
+    CheckResult(close(shared_state->RemainingSpaceWriteEnd()), "close");
+    ring = std::make_unique<IoUring>(4);
+  }
+
+  void PutDish(const std::string& dish_type, bool is_last) override {
+    if (dish_type.size() >= sizeof(UringDishRecord::dish_type)) {
+      throw std::runtime_error("Too long dish type: " + dish_type);
+    }
+    record.seq = seq++;
+    record.last = is_last;
+    record.size = dish_type.size();
+    memcpy(record.dish_type, dish_type.data(), record.size);
+    // Запись данных о посуде связана с чтением байта свободного места и будет
+    // выполнена ядром только после того, как на столе появится место.
+    ring->PrepareRead(shared_state->RemainingSpaceReadEnd(), &credit, sizeof(char), 0, true);
+    ring->PrepareWrite(shared_state->DishesPipeWriteEnd(), &record, sizeof(UringDishRecord), 1);
+    ring->Submit(2);
+    for (int completed = 0; completed < 2;) {
+      io_uring_cqe cqe;
+      if (!ring->PopCompletion(cqe)) {
+        ring->Submit(1);
+        continue;
+      }
+      ++completed;
+      if (cqe.user_data == 0 && CheckCompletion(cqe, "io_uring read") == 0) {
+        throw std::runtime_error("Remaining space pipe was closed");
+      }
+      if (cqe.user_data == 1 && CheckCompletion(cqe, "io_uring write") != sizeof(UringDishRecord)) {
+        throw std::runtime_error("Partial write of dish record");
+      }
+    }
+  }
+
+  void AfterWork() override {
+    ring.reset();
+  }
+
+private:
+  std::shared_ptr<PipeSharedState> shared_state;
+  std::unique_ptr<IoUring> ring;
+  // Буферы запросов должны жить до получения завершений, поэтому хранятся
+  // в полях класса.
+  UringDishRecord record;
+  char credit;
+  uint64_t seq = 0;
+};
+
+// Класс вытирателя, использующего pipe'ы через io_uring. Вытиратель держит
+// в полете несколько чтений записей о посуде, так что при высоком темпе
+// работы несколько посуд забираются из ядра за один системный вызов.
+// Возврат свободного места на стол отправляется вместе с повторной постановкой
+// чтений, не дожидаясь завершения записи.
+class UringWiper : public Wiper {
+public:
+  UringWiper(const Times& wiping_times, std::shared_ptr<PipeSharedState> shared_state)
+    : Wiper(wiping_times), shared_state(shared_state) {}
+
+private:
+  // Количество одновременных чтений из pipe с данными о посуде.
+  static constexpr uint64_t kReadsInFlight = 8;
+  // Значение `user_data` для запросов записи свободного места.
+  static constexpr uint64_t kCreditTag = kReadsInFlight;
+
+  void BeforeWork() override {
+    CheckResult(close(shared_state->DishesPipeWriteEnd()), "close");
+    CheckResult(close(shared_state->RemainingSpaceReadEnd()), "close");
+    ring = std::make_unique<IoUring>(2 * kReadsInFlight);
+    for (uint64_t i = 0; i < kReadsInFlight; ++i) {
+      ring->PrepareRead(shared_state->DishesPipeReadEnd(), &buffers[i], sizeof(UringDishRecord), i);
+    }
+    ring->Submit(0);
+  }
+
+  bool IsWorkDone() override {
+    return took_last;
+  }
+
+  std::string TakeDish() override {
+    // Ждем, пока не будет прочитана очередная по порядку запись.
+    while (ready.find(next_seq) == ready.end()) {
+      ring->Submit(1);
+      ReapCompletions();
+    }
+    auto iter = ready.find(next_seq++);
+    took_last = iter->second.last;
+    std::string dish_type(iter->second.dish_type, iter->second.size);
+    ready.erase(iter);
+    // Добавляем одно свободное место на стол. Запрос отправляется вместе с
+    // повторно поставленными чтениями.
+    ring->PrepareWrite(shared_state->RemainingSpaceWriteEnd(), &credit, sizeof(char), kCreditTag);
+    ring->Submit(0);
+    ReapCompletions();
+    return dish_type;
+  }
+
+  void AfterWork() override {
+    // Оставшиеся чтения будут отменены при закрытии кольца.
+    ring.reset();
+    CheckResult(close(shared_state->DishesPipeReadEnd()), "close");
+    CheckResult(close(shared_state->RemainingSpaceWriteEnd()), "close");
+  }
+
+  // Забирает все доступные завершения: прочитанные записи переносит в `ready`
+  // и ставит чтение в освободившийся буфер повторно.
+  void ReapCompletions() {
+    io_uring_cqe cqe;
+    while (ring->PopCompletion(cqe)) {
+      if (cqe.user_data == kCreditTag) {
+        CheckCompletion(cqe, "io_uring write");
+        continue;
+      }
+      if (CheckCompletion(cqe, "io_uring read") != sizeof(UringDishRecord)) {
+        throw std::runtime_error("Partial read of dish record");
+      }
+      UringDishRecord& record = buffers[cqe.user_data];
+      ready.insert({record.seq, record});
+      ring->PrepareRead(shared_state->DishesPipeReadEnd(), &record, sizeof(UringDishRecord), cqe.user_data);
+    }
+  }
+
+private:
+  std::shared_ptr<PipeSharedState> shared_state;
+  std::unique_ptr<IoUring> ring;
+  std::array<UringDishRecord, kReadsInFlight> buffers;
+  // Прочитанные, но еще не взятые со стола записи, упорядоченные по номеру.
+  std::map<uint64_t, UringDishRecord> ready;
+  uint64_t next_seq = 0;
+  const char credit = 0;
+  bool took_last = false;
+};
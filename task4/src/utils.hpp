@@ -1,14 +1,20 @@
 #pragma once
 
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
+#include <fcntl.h>
 #include <string.h>
-#include <fstream>
-#include <queue>
-#include <sstream>
-#include <string>
-#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // Вспомогательные функции, оборачивающие обработку ошибок c style функций.
 int CheckResult(int result, const std::string& operation) {
@@ -25,41 +31,164 @@ void* CheckResult(void* result, const std::string& operation) {
   return result;
 }
 
-struct Times : public std::unordered_map<std::string, int> {
-  static Times LoadFromFile(const std::string& filepath) {
-    std::ifstream reader(filepath);
-    if (!reader) {
-      throw std::runtime_error("Couldn't read file " + filepath);
+// Читает ровно `size` байт из `fd`. Бросает исключение, если данные
+// закончились раньше.
+void ReadAll(int fd, void* data, size_t size) {
+  while (size > 0) {
+    ssize_t was_read = CheckResult(read(fd, data, size), "read");
+    if (was_read == 0) {
+      throw std::runtime_error("Unexpected end of data");
     }
+    data = (char*)data + was_read;
+    size -= was_read;
+  }
+}
 
-    Times times;
-    std::string buffer;
-    while (std::getline(reader, buffer)) {
-      std::istringstream line(buffer);
-      std::string dish_type;
-      char colon;
-      std::string time_str;
-      int time;
+// Записывает ровно `size` байт в `fd`.
+void WriteAll(int fd, const void* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = CheckResult(write(fd, data, size), "write");
+    data = (const char*)data + written;
+    size -= written;
+  }
+}
 
-      if (!(line >> dish_type)) {
-        throw std::runtime_error("Expected dish type");
-      }
-      if (!(line >> colon) || (colon != ':')) {
-        throw std::runtime_error("Expected ':' delimiter");
-      }
-      if (!(line >> time_str)) {
-        throw std::runtime_error("Expected operation time");
-      }
-      try {
-        time = std::stoi(time_str);
-        if (time < 0) {
-          throw std::exception();
-        }
-      }
-      catch (...) {
-        throw std::runtime_error("Invalid operation time");
+// Заполняет полезную нагрузку посуды с порядковым номером `index`.
+inline void FillPayload(char* payload, size_t size, uint64_t index) {
+  memset(payload, (char)index, size);
+}
+
+// Проверяет, что полезная нагрузка посуды с порядковым номером `index`
+// дошла до вытирателя неповрежденной. Проверяются первый и последний байты,
+// чтобы вытиратель обращался к данным, но не тратил время на полный проход.
+inline void CheckPayload(const char* payload, size_t size, uint64_t index) {
+  if (size > 0 && (payload[0] != (char)index || payload[size - 1] != (char)index)) {
+    throw std::runtime_error("Dish payload is corrupted");
+  }
+}
+
+// Файл, отображенный в память только для чтения. Используется для
+// разбора файлов с данными без построчного чтения через потоки: данные
+// читаются прямо из страничного кэша по мере обращения к ним.
+class MappedFile {
+public:
+  MappedFile(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd == -1) {
+      throw std::runtime_error("Couldn't open file " + filepath);
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+      close(fd);
+      throw std::runtime_error("Couldn't stat file " + filepath);
+    }
+    size = info.st_size;
+    if (size > 0) {
+      addr = (const char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Couldn't map file " + filepath + ": " + strerror(errno));
       }
-      times.insert({dish_type, time});
+      // Файл читается последовательно: ядро будет читать страницы заранее.
+      madvise((void*)addr, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (size > 0) {
+      munmap((void*)addr, size);
+    }
+  }
+
+  const char* Begin() const { return addr; }
+  const char* End() const { return addr + size; }
+
+  // Сообщает ядру, что данные до `position` больше не нужны, чтобы
+  // прочитанные страницы не занимали память процесса.
+  void Release(const char* position) {
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    const size_t length = (position - addr) / page_size * page_size;
+    if (length > released) {
+      madvise((void*)(addr + released), length - released, MADV_DONTNEED);
+      released = length;
+    }
+  }
+
+private:
+  const char* addr = nullptr;
+  size_t size = 0;
+  // Размер начала файла, уже отданного ядру.
+  size_t released = 0;
+};
+
+// Разбирает одну строку формата `<тип посуды> : <число>`, начинающуюся с
+// `position`, и сдвигает `position` на начало следующей строки. Правила
+// разбора совпадают с чтением строки через `std::istringstream`: тип посуды -
+// последовательность непробельных символов, число может иметь знак и
+// завершается первым нецифровым символом, остаток строки игнорируется.
+// `value_name` и `invalid_value` используются в сообщениях об ошибках.
+inline void ParseRecordLine(const char*& position, const char* end,
+                            std::string_view& dish_type, int& value,
+                            const std::string& value_name, const std::string& invalid_value) {
+  const char* line_end = (const char*)memchr(position, '\n', end - position);
+  if (line_end == nullptr) {
+    line_end = end;
+  }
+  const char* iter = position;
+  position = line_end == end ? end : line_end + 1;
+
+  auto skip_spaces = [&]() {
+    while (iter < line_end && isspace((unsigned char)*iter)) {
+      ++iter;
+    }
+  };
+  auto read_token = [&]() {
+    skip_spaces();
+    const char* token_begin = iter;
+    while (iter < line_end && !isspace((unsigned char)*iter)) {
+      ++iter;
+    }
+    return std::string_view(token_begin, iter - token_begin);
+  };
+
+  dish_type = read_token();
+  if (dish_type.empty()) {
+    throw std::runtime_error("Expected dish type");
+  }
+  skip_spaces();
+  if (iter == line_end || *iter != ':') {
+    throw std::runtime_error("Expected ':' delimiter");
+  }
+  ++iter;
+  std::string_view value_str = read_token();
+  if (value_str.empty()) {
+    throw std::runtime_error("Expected " + value_name);
+  }
+  const char* number_begin = value_str.data();
+  if (*number_begin == '+') {
+    ++number_begin;
+  }
+  auto [number_end, error] = std::from_chars(number_begin, value_str.data() + value_str.size(), value);
+  if (error != std::errc() || number_end == number_begin || value < 0) {
+    throw std::runtime_error(invalid_value);
+  }
+}
+
+struct Times : public std::unordered_map<std::string, int> {
+  static Times LoadFromFile(const std::string& filepath) {
+    MappedFile file(filepath);
+    Times times;
+    const char* position = file.Begin();
+    while (position < file.End()) {
+      std::string_view dish_type;
+      int time;
+      ParseRecordLine(position, file.End(), dish_type, time, "operation time",
+                      "Invalid operation time");
+      times.insert({std::string(dish_type), time});
     }
     return times;
   }
@@ -70,42 +199,57 @@ struct WashTask {
   int count;
 };
 
-struct WashTaskQueue : public std::queue<WashTask> {
+// Очередь задач на мытье, читаемая из отображенного в память файла по мере
+// извлечения задач. Загрузка очереди занимает постоянное время, а в памяти
+// одновременно хранится только очередная задача, поэтому размер очереди не
+// ограничен доступной памятью. Копии очереди разделяют отображение файла, но
+// имеют собственные позиции чтения. Ошибки формата обнаруживаются при
+// извлечении соответствующей задачи.
+class WashTaskQueue {
+public:
   static WashTaskQueue LoadFromFile(const std::string& filepath) {
-    std::ifstream reader(filepath);
-    if (!reader) {
-      throw std::runtime_error("Couldn't open file " + filepath);
-    }
-
     WashTaskQueue queue;
-    std::string buffer;
-    while (std::getline(reader, buffer)) {
-      std::istringstream line(buffer);
-      std::string dish_type;
-      char colon;
-      std::string count_str;
-      int count;
-
-      if (!(line >> dish_type)) {
-        throw std::runtime_error("Expected dish type");
-      }
-      if (!(line >> colon) || (colon != ':')) {
-        throw std::runtime_error("Expected ':' delimiter");
-      }
-      if (!(line >> count_str)) {
-        throw std::runtime_error("Expected count of dishes");
-      }
-      try {
-        count = std::stoi(count_str);
-        if (count < 0) {
-          throw std::exception();
-        }
-      }
-      catch (...) {
-        throw std::runtime_error("Invalid number of dishes to wash");
-      }
-      queue.push({dish_type, count});
-    }
+    queue.file = std::make_shared<MappedFile>(filepath);
+    queue.position = queue.file->Begin();
+    queue.ParseNext();
     return queue;
   }
+
+  bool empty() const {
+    return !next.has_value();
+  }
+
+  const WashTask& front() const {
+    return *next;
+  }
+
+  void pop() {
+    ParseNext();
+  }
+
+private:
+  // Размер прочитанной части файла, после которого она отдается ядру.
+  static constexpr size_t kReleaseStep = 1 << 20;
+
+  void ParseNext() {
+    if (position == file->End()) {
+      next.reset();
+      return;
+    }
+    std::string_view dish_type;
+    int count;
+    ParseRecordLine(position, file->End(), dish_type, count, "count of dishes",
+                    "Invalid number of dishes to wash");
+    next = WashTask{std::string(dish_type), count};
+    if ((size_t)(position - file->Begin()) >= released_until + kReleaseStep) {
+      file->Release(position);
+      released_until = position - file->Begin();
+    }
+  }
+
+  std::shared_ptr<MappedFile> file;
+  const char* position = nullptr;
+  size_t released_until = 0;
+  // Очередная задача, возвращаемая `front()`.
+  std::optional<WashTask> next;
 };
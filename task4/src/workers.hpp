@@ -5,9 +5,12 @@
 #include <memory>
 #include <string>
 
+#include <signal.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include "event_log.hpp"
+#include "placement.hpp"
 #include "utils.hpp"
 
 // Класс, использующийся для инициализации и освобождения ресурсов, общих для
@@ -23,13 +26,21 @@ struct SharedState {
 // какой-то работы (мытье, вытирание)) и средства для логгирования.
 class Worker {
 public:
-  Worker(const std::string& name) : name(name) {}
+  Worker(WorkerId id) : id(id) {}
   virtual ~Worker() = default;
 
+  // Переключает логирование всех работников в бинарный формат (см.
+  // `BinaryEventLog`). Должен вызываться до начала работы.
+  static void UseBinaryLog(bool value) {
+    binary_log = value;
+  }
+
 protected:
   // Метод, позволяющий процессу заснуть на `secs` секунд.
   void Sleep(int secs) {
-    while (true) {
+    // `sleep(0)` все равно выполняет системный вызов и может задержать
+    // процесс на величину timer slack, поэтому нулевое время пропускаем.
+    while (secs > 0) {
       int seconds_passed = CheckResult(sleep(secs), "sleep");
       if (seconds_passed == 0) {
         return;
@@ -41,37 +52,47 @@ protected:
     }
   }
 
-  // Класс логгера, использующийся дочерними классами для логирования своих
-  // действий.
-  struct Logger {
-    Logger(const std::string& value) {
-      std::cout << value;
+  // Запускает фоновую запись бинарного лога в текущем процессе, если
+  // включен бинарный формат. Вызывается в процессе, выполняющем работу.
+  void StartLog() {
+    if (binary_log) {
+      event_log = std::make_unique<BinaryEventLog>(id);
     }
-    template<typename T>
-    Logger& operator<<(const T& value) {
-      std::cout << value;
-      return *this;
-    }
-    ~Logger() { std::cout << std::endl; }
-  };
+  }
 
-  // Метод, выводящий имя работника и текущее время и возвращающий класс логгера.
-  Logger Log() {
-    return Logger(name + " " + std::to_string(GetSecond()) + " sec: ");
+  // Дожидается записи всех событий бинарного лога.
+  void StopLog() {
+    event_log.reset();
+  }
+
+  // Логирует событие работника с текущим временем. В текстовом формате
+  // строка сразу выводится в stdout, в бинарном - событие передается
+  // фоновому потоку.
+  void Log(EventKind kind, const std::string& dish_type = "", int duration = 0) {
+    const uint32_t timestamp_ms = GetMilliseconds();
+    if (event_log) {
+      event_log->Record(timestamp_ms, kind, dish_type, duration);
+    }
+    else {
+      std::cout << FormatEvent(id, TimestampToSecond(timestamp_ms), kind, dish_type, duration)
+                << std::endl;
+    }
   }
 
 private:
-  // Возвращает количество секунд с момента создания объекта класса.
-  int GetSecond() {
+  // Возвращает количество миллисекунд с момента создания объекта класса.
+  uint32_t GetMilliseconds() {
     auto now = std::chrono::steady_clock::now();
-    int ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
-    return (ms + 100) / 1000;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
   }
 
-  // Имя(вид) работника, использующееся для логгирования.
-  std::string name;
+  inline static bool binary_log = false;
+
+  // Вид работника, использующийся для логгирования.
+  WorkerId id;
   // Время создания объекта для логгирования.
   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::unique_ptr<BinaryEventLog> event_log;
 };
 
 // Абстрактный класс мойщика. Имеет абстрактный метод `Work()`, симулирующий
@@ -83,9 +104,10 @@ private:
 // синхронизации процессов.
 class Washer : public Worker {
 public:
-  Washer(const Times& washing_times) : Worker("WASHER"), washing_times(washing_times) {}
+  Washer(const Times& washing_times) : Worker(WorkerId::Washer), washing_times(washing_times) {}
 
   void Work(WashTaskQueue queue) {
+    StartLog();
     BeforeWork();
     while (!queue.empty()) {
       WashTask task = queue.front();
@@ -96,13 +118,14 @@ public:
         --task.count;
         // Ставим вымытую посуду на стол (если стол полон, ждем, пока Wiper
         // заберет одну).
-        Log() << "Trying to put " << task.dish_type << " on the table";
+        Log(EventKind::TryingToPut, task.dish_type);
         PutDish(task.dish_type, queue.empty() && task.count == 0);
-        Log() << "Put " << task.dish_type << " on the table";
+        Log(EventKind::Put, task.dish_type);
       }
     }
-    Log() << "Finished work";
+    Log(EventKind::Finished);
     AfterWork();
+    StopLog();
   }
 
 protected:
@@ -116,7 +139,7 @@ protected:
   // Метод, симулирующий мытье посуды типа `dish_type`.
   void Wash(const std::string& dish_type) {
     const int washing_time = washing_times.at(dish_type);
-    Log() << "Wash " << dish_type << " for " << washing_time << " seconds";
+    Log(EventKind::Wash, dish_type, washing_time);
     Sleep(washing_time);
   }
 
@@ -134,25 +157,42 @@ private:
 // логику работы с каким-то конкретным средством синхронизации процессов.
 class Wiper : public Worker {
 public:
-  Wiper(const Times& wiping_times) : Worker("WIPER "), wiping_times(wiping_times) {}
+  Wiper(const Times& wiping_times) : Worker(WorkerId::Wiper), wiping_times(wiping_times) {}
 
   void Work() {
     pid = CheckResult(fork(), "fork");
     if (pid == 0) {
+      if (cpu >= 0) {
+        BindToCpu(cpu);
+      }
+      StartLog();
       BeforeWork();
       while (!IsWorkDone()) {
         // Ждем, пока на столе будет хотя бы одна посуда, и забираем ее.
-        Log() << "Trying to get dish from the table";
+        Log(EventKind::TryingToGet);
         std::string dish_type = TakeDish();
-        Log() << "Got " << dish_type << " from the table";
+        Log(EventKind::Got, dish_type);
         Wipe(dish_type);
       }
-      Log() << "Finished work";
+      Log(EventKind::Finished);
       AfterWork();
+      StopLog();
       exit(0);
     }
   }
 
+  // Задает логический процессор, к которому будет привязан процесс
+  // вытирателя. Должен вызываться до `Work()`.
+  void SetCpu(int cpu) {
+    this->cpu = cpu;
+  }
+
+  // Принудительно завершает процесс вытирателя. Используется, если мойщик
+  // не может продолжить работу и вытиратель никогда не дождется посуды.
+  void Kill() {
+    kill(pid, SIGKILL);
+  }
+
   // Ожидает завершения выполнения процесса.
   void Join() {
     while (waitpid(pid, NULL, 0) != pid) {}
@@ -171,7 +211,7 @@ protected:
   // Метод, симулирующий вытирание посуды типа `dish_type`.
   void Wipe(const std::string& dish_type) {
     const int wiping_time = wiping_times.at(dish_type);
-    Log() << "Wipe " << dish_type << " for " << wiping_time << " seconds";
+    Log(EventKind::Wipe, dish_type, wiping_time);
     Sleep(wiping_time);
   }
 
@@ -181,4 +221,6 @@ private:
   Times wiping_times;
   // Идентификатор созданного процесса.
   int pid;
+  // Логический процессор для процесса вытирателя, -1 - без привязки.
+  int cpu = -1;
 };
@@ -1,26 +1,153 @@
 #include "async_multiplier.hpp"
 
+#include "modular.hpp"
+
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <mutex>
 #include <thread>
 
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 namespace {
 
-// Функция, вычисляющая произведение чисел от `from` до `to`.
-uint64_t Multiply(uint64_t from, uint64_t to) {
-  if (from > to) {
-    throw std::runtime_error("`to` should be equal or greater than `from`");
+// Процессорное время, затраченное вызывающим потоком.
+std::chrono::nanoseconds ThreadCpuTime() {
+  timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+}
+
+// Записывает в `fd` ровно `size` байт.
+void WriteAll(int fd, const void* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written == -1) {
+      throw std::runtime_error(strerror(errno));
+    }
+    data = (const char*)data + written;
+    size -= written;
   }
-  uint64_t result = from;
-  for (uint64_t i = from + 1; i <= to; ++i) {
-    result *= i;
+}
+
+// Читает из `fd` ровно `size` байт.
+void ReadAll(int fd, void* data, size_t size) {
+  while (size > 0) {
+    ssize_t was_read = read(fd, data, size);
+    if (was_read == -1) {
+      throw std::runtime_error(strerror(errno));
+    }
+    if (was_read == 0) {
+      throw std::runtime_error("Unexpected end of data");
+    }
+    data = (char*)data + was_read;
+    size -= was_read;
   }
-  return result;
 }
-    
+
+// Общая память процессов: файл в памяти (memfd), отображенный в адресное
+// пространство каждого процесса. Файл создается до `fork()`, поэтому его
+// дескриптор есть у обоих процессов. Размер файла только растет: процесс,
+// которому не хватает места, увеличивает файл и сообщает новый размер
+// другому процессу, а тот заново отображает файл вызовом `Sync()`.
+class SharedArena {
+public:
+  SharedArena() : fd(memfd_create("multiplier-arena", MFD_CLOEXEC)) {
+    if (fd == -1) {
+      throw std::runtime_error(strerror(errno));
+    }
+  }
+
+  SharedArena(const SharedArena&) = delete;
+  SharedArena& operator=(const SharedArena&) = delete;
+
+  ~SharedArena() {
+    Unmap();
+    close(fd);
+  }
+
+  // Увеличивает файл так, чтобы в нем помещалось `size` байт. Размер
+  // увеличивается хотя бы вдвое, чтобы растущие результаты не требовали
+  // нового отображения каждый раз.
+  void Reserve(size_t size) {
+    if (size <= capacity) {
+      return;
+    }
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t new_capacity = (std::max(size, 2 * capacity) + page - 1) / page * page;
+    if (ftruncate(fd, new_capacity) == -1) {
+      throw std::runtime_error(strerror(errno));
+    }
+    Sync(new_capacity);
+  }
+
+  // Отображает файл заново, если другой процесс увеличил его до `new_capacity`
+  // байт.
+  void Sync(size_t new_capacity) {
+    if (new_capacity <= capacity) {
+      return;
+    }
+    Unmap();
+    void* mapped = mmap(nullptr, new_capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      throw std::runtime_error(strerror(errno));
+    }
+    data = mapped;
+    capacity = new_capacity;
+  }
+
+  void* Data() const {
+    return data;
+  }
+
+  size_t Capacity() const {
+    return capacity;
+  }
+
+private:
+  void Unmap() {
+    if (capacity > 0) {
+      munmap(data, capacity);
+    }
+    data = nullptr;
+    capacity = 0;
+  }
+
+  int fd;
+  void* data = nullptr;
+  size_t capacity = 0;
+};
+
+// Задача вычислителя: произведение отрезка `[from, to]` (по модулю
+// `modulus`, если он не равен 0) или произведение чисел из массива `factors`.
+struct MultiplyTask {
+  bool is_range = true;
+  uint64_t from = 0;
+  uint64_t to = 0;
+  std::vector<uint64_t> factors;
+  uint64_t modulus = 0;
+
+  BigInteger Compute() const {
+    if (!is_range) {
+      return ListProduct(factors);
+    }
+    return modulus == 0 ? RangeProduct(from, to) : BigInteger(RangeProductMod(from, to, modulus));
+  }
+};
+
+// Вид команды, передаваемой процессу вычислителя.
+enum struct Command : uint8_t {
+  Finish,
+  Range,
+  Factors,
+  RangeMod,
+};
+
 // Реализация асинхронного вычислителя произведения, использующая потоки.
 // Для межпотокового взаимодействия используются мьютекс для предотвращения
 // гонок и условная переманная для ожидания нужных состояний.
@@ -29,34 +156,42 @@ public:
   ThreadAcyncMultiplier() : thread(&ThreadAcyncMultiplier::Run, this) {}
 
   void SetTask(uint64_t from, uint64_t to) override {
-    // Захватываем мьютекс, задаем параметры для вычисления и оповещаем поток
-    // вычислителя о появлении задачи.
-    std::unique_lock lock(mutex);
-    this->from = from;
-    this->to = to;
-    lock.unlock();
-    cv.notify_one();
+    SetTask(MultiplyTask{true, from, to, {}, 0});
   }
 
-  uint64_t GetResult() override {
+  void SetFactorsTask(std::vector<uint64_t> factors) override {
+    SetTask(MultiplyTask{false, 0, 0, std::move(factors)});
+  }
+
+  void SetModTask(uint64_t from, uint64_t to, uint64_t modulus) override {
+    SetTask(MultiplyTask{true, from, to, {}, modulus});
+  }
+
+  std::optional<BigInteger> GetResult() override {
     std::unique_lock lock(mutex);
     // Ожидаем на условной переменной, пока в поле `result` не появится
-    // ненулевое значение.
-    while (result == 0) {
-      // Если поля `from` и `result` равны 0, у вычислителя нет результата
+    // значение.
+    while (!result) {
+      // Если нет ни задачи, ни результата, у вычислителя нет результата
       // какого-либо вычисления и нет выполняющейся задачи. В этом случае
-      // возвращаем 0.
-      if (from == 0) {
-        return 0;
+      // возвращаем пустой результат.
+      if (!task) {
+        return std::nullopt;
       }
       cv.wait(lock);
     }
-    uint64_t result_ = result;
-    result = 0;
+    std::optional<BigInteger> result_ = std::move(result);
+    result.reset();
+    busy_time += result_busy_time;
     lock.unlock();
     return result_;
   }
 
+  std::chrono::nanoseconds GetBusyTime() override {
+    std::unique_lock lock(mutex);
+    return busy_time;
+  }
+
   void Finish() override {
     std::unique_lock lock(mutex);
     // Переключаем значение поля `should_finish` и оповещаем поток вычислителя.
@@ -68,44 +203,188 @@ public:
   }
 
 private:
+  void SetTask(MultiplyTask new_task) {
+    // Захватываем мьютекс, задаем параметры для вычисления и оповещаем поток
+    // вычислителя о появлении задачи.
+    std::unique_lock lock(mutex);
+    task = std::move(new_task);
+    lock.unlock();
+    cv.notify_one();
+  }
+
   void Run() {
     // Функция, выполняющаяся вычислителем. Ожидаем задачи в бесконечном цикле,
     // пока не получим сигнал о завершении.
     while (true) {
       std::unique_lock lock(mutex);
       // Ждем на условной переменной появления задачи.
-      while (from == 0) {
-        cv.wait(lock);
-        // Если был вызван метод `Finish()`, завершаем выполнение.
+      while (!task) {
+        // Если был вызван метод `Finish()`, завершаем выполнение. Проверяем
+        // флаг до ожидания, иначе оповещение, отправленное, пока поток
+        // вычислял предыдущую задачу, было бы потеряно.
         if (should_finish) {
           return;
         }
+        cv.wait(lock);
       }
       // Вычисляем результат и оповещаем родительский поток.
-      result = Multiply(from, to);
-      from = to = 0;
+      const std::chrono::nanoseconds start = ThreadCpuTime();
+      result = task->Compute();
+      result_busy_time = ThreadCpuTime() - start;
+      task.reset();
       lock.unlock();
       cv.notify_one();
     }
   }
 
-  // Поля `from` и `to` хранят данные о задаче на вычисление произведения.
-  // Если `from` равно 0, у вычислителя в данный момент нет никакой
-  // незавершенной задачи.
-  uint64_t from = 0;
-  uint64_t to = 0;
-  // Поле `result` хранит результат вычисления. Если `result` равно 0, значит
+  // Задача на вычисление произведения. Если задачи нет, у вычислителя в
+  // данный момент нет никакой незавершенной задачи.
+  std::optional<MultiplyTask> task;
+  // Поле `result` хранит результат вычисления. Если `result` пусто, значит
   // вычислитель еще не получал ни одной задачи или результат уже был получен
-  // вызовом метода `GetResult()`. 
-  uint64_t result = 0;
-  std::thread thread;
+  // вызовом метода `GetResult()`.
+  std::optional<BigInteger> result;
+  // Время вычисления `result` и суммарное время вычисления уже полученных
+  // результатов.
+  std::chrono::nanoseconds result_busy_time{0};
+  std::chrono::nanoseconds busy_time{0};
   std::mutex mutex;
   std::condition_variable cv;
   bool should_finish = false;
+  // Поток объявлен последним: он запускается в конструкторе и сразу
+  // обращается к остальным полям, поэтому они должны быть уже
+  // инициализированы.
+  std::thread thread;
+};
+
+// Реализация асинхронного вычислителя произведения, использующая потоки и
+// атомарную ячейку состояния вместо мьютекса. Задачу в поле `task` пишет
+// только главный поток, пока ячейка равна `kIdle`, а результат в поле `result`
+// - только поток вычислителя, пока ячейка равна `kTask`. Запись в ячейку
+// (release) публикует записанное, чтение (acquire) делает его видимым.
+class AtomicAsyncMultiplier : public AsyncMultiplier {
+public:
+  explicit AtomicAsyncMultiplier(bool spin)
+      : spin_count(spin ? kSpinCount : 0), thread(&AtomicAsyncMultiplier::Run, this) {}
+
+  void SetTask(uint64_t from, uint64_t to) override {
+    SetTask(MultiplyTask{true, from, to, {}, 0});
+  }
+
+  void SetFactorsTask(std::vector<uint64_t> factors) override {
+    SetTask(MultiplyTask{false, 0, 0, std::move(factors)});
+  }
+
+  void SetModTask(uint64_t from, uint64_t to, uint64_t modulus) override {
+    SetTask(MultiplyTask{true, from, to, {}, modulus});
+  }
+
+  std::optional<BigInteger> GetResult() override {
+    uint32_t current = state.load(std::memory_order_acquire);
+    if (current == kIdle) {
+      return std::nullopt;
+    }
+    while (current == kTask) {
+      current = WaitWhile(kTask);
+    }
+    std::optional<BigInteger> result_ = std::move(result);
+    result.reset();
+    busy_time += result_busy_time.count();
+    // Поток вычислителя ждет только появления задачи, поэтому будить его не
+    // нужно.
+    state.store(kIdle, std::memory_order_release);
+    return result_;
+  }
+
+  std::chrono::nanoseconds GetBusyTime() override {
+    return std::chrono::nanoseconds(busy_time.load());
+  }
+
+  void Finish() override {
+    state.store(kFinish, std::memory_order_release);
+    state.notify_all();
+    thread.join();
+  }
+
+private:
+  // Значения ячейки состояния: нет ни задачи, ни результата; есть
+  // невыполненная задача; есть неполученный результат; вычислитель должен
+  // завершиться.
+  static constexpr uint32_t kIdle = 0;
+  static constexpr uint32_t kTask = 1;
+  static constexpr uint32_t kResult = 2;
+  static constexpr uint32_t kFinish = 3;
+  // Количество проверок ячейки перед засыпанием при `ThreadHandoff::AtomicSpin`.
+  static constexpr int kSpinCount = 200;
+
+  void SetTask(MultiplyTask new_task) {
+    task = std::move(new_task);
+    state.store(kTask, std::memory_order_release);
+    state.notify_all();
+  }
+
+  // Ждет, пока ячейка не перестанет быть равной `old`, и возвращает ее новое
+  // значение. Ячейку ждут оба потока (с разными значениями), поэтому
+  // изменения сопровождаются `notify_all()`.
+  uint32_t WaitWhile(uint32_t old) {
+    for (int i = 0; i < spin_count; ++i) {
+      const uint32_t current = state.load(std::memory_order_acquire);
+      if (current != old) {
+        return current;
+      }
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    }
+    state.wait(old, std::memory_order_acquire);
+    return state.load(std::memory_order_acquire);
+  }
+
+  void Run() {
+    while (true) {
+      uint32_t current = state.load(std::memory_order_acquire);
+      while (current != kTask && current != kFinish) {
+        current = WaitWhile(current);
+      }
+      if (current == kFinish) {
+        return;
+      }
+      const std::chrono::nanoseconds start = ThreadCpuTime();
+      result = task->Compute();
+      result_busy_time = ThreadCpuTime() - start;
+      task.reset();
+      // Если пока задача вычислялась, был вызван `Finish()`, ячейка равна
+      // `kFinish` и не должна быть перезаписана.
+      uint32_t expected = kTask;
+      if (!state.compare_exchange_strong(expected, kResult, std::memory_order_acq_rel)) {
+        return;
+      }
+      state.notify_all();
+    }
+  }
+
+  std::optional<MultiplyTask> task;
+  std::optional<BigInteger> result;
+  std::chrono::nanoseconds result_busy_time{0};
+  // Суммарное время вычисления полученных результатов в наносекундах.
+  // Читается из любого потока.
+  std::atomic<int64_t> busy_time{0};
+  std::atomic<uint32_t> state{kIdle};
+  const int spin_count;
+  // Поток объявлен последним, см. `ThreadAcyncMultiplier`.
+  std::thread thread;
 };
 
 // Реализация асинхронного вычислителя произведения, использующая процессы.
-// Для межпроцессорного взаимодействия используются пары pipe'ов.
+// Для межпроцессорного взаимодействия используются пары pipe'ов и общая
+// память (`SharedArena`). Массив множителей записывается в начало общей
+// памяти, а вычислитель записывает цифры результата после него: последнее
+// умножение дерева произведения пишет их прямо в общую память
+// (`RangeProductInto()`, `ListProductInto()`). Результат лежит там, пока его
+// не заберет `GetResult()`, - это единственная копия цифр; следующая задача
+// ставится только после этого. По pipe'ам передаются только команды,
+// количества чисел, смещение результата, размер общей памяти и время
+// вычисления.
 class ProcessAsyncMultiplier : public AsyncMultiplier {
 public:
   ProcessAsyncMultiplier() {
@@ -136,30 +415,75 @@ public:
   }
 
   void SetTask(uint64_t from, uint64_t to) override {
-    // Отправляем в pipe 3 значения - флаг о завершении выполнения и два числа.
-    bool should_finish = false;
-    write(to_child_write_end, &should_finish, sizeof(bool));
-    write(to_child_write_end, &from, sizeof(uint64_t));
-    write(to_child_write_end, &to, sizeof(uint64_t));
+    CheckResultTaken();
+    // Отправляем в pipe 3 значения - вид команды и два числа.
+    Command command = Command::Range;
+    WriteAll(to_child_write_end, &command, sizeof(Command));
+    WriteAll(to_child_write_end, &from, sizeof(uint64_t));
+    WriteAll(to_child_write_end, &to, sizeof(uint64_t));
+    expects_result = true;
+  }
+
+  void SetFactorsTask(std::vector<uint64_t> factors) override {
+    CheckResultTaken();
+    // Записываем числа в начало общей памяти и отправляем в pipe вид
+    // команды, количество чисел и размер общей памяти.
+    Command command = Command::Factors;
+    uint64_t count = factors.size();
+    arena.Reserve(count * sizeof(uint64_t));
+    if (count > 0) {
+      memcpy(arena.Data(), factors.data(), count * sizeof(uint64_t));
+    }
+    uint64_t capacity = arena.Capacity();
+    WriteAll(to_child_write_end, &command, sizeof(Command));
+    WriteAll(to_child_write_end, &count, sizeof(uint64_t));
+    WriteAll(to_child_write_end, &capacity, sizeof(uint64_t));
     expects_result = true;
   }
 
-  uint64_t GetResult() override {
+  void SetModTask(uint64_t from, uint64_t to, uint64_t modulus) override {
+    CheckResultTaken();
+    // Отправляем в pipe вид команды, границы отрезка и модуль.
+    Command command = Command::RangeMod;
+    WriteAll(to_child_write_end, &command, sizeof(Command));
+    WriteAll(to_child_write_end, &from, sizeof(uint64_t));
+    WriteAll(to_child_write_end, &to, sizeof(uint64_t));
+    WriteAll(to_child_write_end, &modulus, sizeof(uint64_t));
+    expects_result = true;
+  }
+
+  std::optional<BigInteger> GetResult() override {
     if (!expects_result) {
-      return 0;
+      return std::nullopt;
     }
-    // Блокируемся на чтении из pipe результата.
-    uint64_t result;
-    read(to_parent_read_end, &result, sizeof(uint64_t));
+    // Блокируемся на чтении из pipe смещения и количества цифр результата,
+    // размера общей памяти и времени вычисления. Вычислитель записал цифры в
+    // общую память на месте, поэтому здесь они копируются единственный раз.
+    uint64_t offset;
+    uint64_t size;
+    uint64_t capacity;
+    int64_t task_busy_time;
+    ReadAll(to_parent_read_end, &offset, sizeof(uint64_t));
+    ReadAll(to_parent_read_end, &size, sizeof(uint64_t));
+    ReadAll(to_parent_read_end, &capacity, sizeof(uint64_t));
+    ReadAll(to_parent_read_end, &task_busy_time, sizeof(int64_t));
+    arena.Sync(capacity);
+    const BigInteger::Limb* data = (const BigInteger::Limb*)((const char*)arena.Data() + offset);
+    std::vector<BigInteger::Limb> limbs(data, data + size);
+    busy_time += std::chrono::nanoseconds(task_busy_time);
     expects_result = false;
-    return result;
+    return BigInteger::FromLimbs(std::move(limbs));
+  }
+
+  std::chrono::nanoseconds GetBusyTime() override {
+    return busy_time;
   }
 
   void Finish() override {
-    // Пишем в pipe флаг о завершении выполнения процесса и закрываем созданные
-    // дескрипторы.
-    bool should_finish = true;
-    write(to_child_write_end, &should_finish, sizeof(bool));
+    // Пишем в pipe команду о завершении выполнения процесса и закрываем
+    // созданные дескрипторы.
+    Command command = Command::Finish;
+    WriteAll(to_child_write_end, &command, sizeof(Command));
     close(to_child_write_end);
     close(to_parent_read_end);
     // Ждем завершения дочернего процесса.
@@ -168,6 +492,14 @@ public:
   }
 
 private:
+  // Следующая задача записывается в ту же общую память, где лежит результат
+  // предыдущей, поэтому ставить ее можно только после `GetResult()`.
+  void CheckResultTaken() const {
+    if (expects_result) {
+      throw std::runtime_error("The previous result has not been taken");
+    }
+  }
+
   void CreatePipe(int& read_end_fd, int& write_end_fd) {
     int pipefds[2];
     if (pipe(pipefds) == -1) {
@@ -178,25 +510,72 @@ private:
   }
 
   void Task() {
-    // В бесконечном цикле получаем значение флага о завершении выполнения
-    // и параметры задачи.
+    // В бесконечном цикле получаем команду и параметры задачи, пока не
+    // получим команду о завершении выполнения.
     while (true) {
-      bool should_finish = false;
-      read(to_child_read_end, &should_finish, sizeof(bool));
-      if (should_finish) {
+      Command command;
+      ReadAll(to_child_read_end, &command, sizeof(Command));
+      if (command == Command::Finish) {
         return;
       }
 
-      uint64_t from, to;
-      read(to_child_read_end, &from, sizeof(uint64_t));
-      read(to_child_read_end, &to, sizeof(uint64_t));
-
-      uint64_t result = Multiply(from, to);
-      // Отправляем в главный процесс результат вычисления.
-      write(to_parent_write_end, &result, sizeof(uint64_t));
+      // Результат записывается в общую память на месте, по смещению
+      // `offset`: после массива множителей задачи, если он там есть.
+      uint64_t offset = 0;
+      auto allocate = [this, &offset](size_t size) {
+        arena.Reserve(offset + size * sizeof(BigInteger::Limb));
+        return (BigInteger::Limb*)((char*)arena.Data() + offset);
+      };
+      uint64_t size;
+      std::chrono::nanoseconds start;
+      if (command == Command::Factors) {
+        uint64_t count;
+        uint64_t capacity;
+        ReadAll(to_child_read_end, &count, sizeof(uint64_t));
+        ReadAll(to_child_read_end, &capacity, sizeof(uint64_t));
+        arena.Sync(capacity);
+        offset = (count * sizeof(uint64_t) + kResultAlignment - 1) / kResultAlignment * kResultAlignment;
+        start = ThreadCpuTime();
+        // Множители читаются прямо из общей памяти; `ListProductInto()`
+        // прочитает их все до того, как `allocate()` может отобразить
+        // память заново.
+        size = ListProductInto((const uint64_t*)arena.Data(), count, allocate);
+      }
+      else {
+        uint64_t from;
+        uint64_t to;
+        uint64_t modulus = 0;
+        ReadAll(to_child_read_end, &from, sizeof(uint64_t));
+        ReadAll(to_child_read_end, &to, sizeof(uint64_t));
+        if (command == Command::RangeMod) {
+          ReadAll(to_child_read_end, &modulus, sizeof(uint64_t));
+        }
+        start = ThreadCpuTime();
+        if (modulus == 0) {
+          size = RangeProductInto(from, to, allocate);
+        }
+        else {
+          const BigInteger result(RangeProductMod(from, to, modulus));
+          size = result.Limbs().size();
+          std::copy(result.Limbs().begin(), result.Limbs().end(), allocate(size));
+        }
+      }
+      const int64_t task_busy_time = (ThreadCpuTime() - start).count();
+      // Отправляем в главный процесс смещение и количество цифр результата,
+      // размер общей памяти и время вычисления.
+      uint64_t capacity = arena.Capacity();
+      WriteAll(to_parent_write_end, &offset, sizeof(uint64_t));
+      WriteAll(to_parent_write_end, &size, sizeof(uint64_t));
+      WriteAll(to_parent_write_end, &capacity, sizeof(uint64_t));
+      WriteAll(to_parent_write_end, &task_busy_time, sizeof(int64_t));
     }
   }
 
+  // Выравнивание результата в общей памяти (размер строки кэша).
+  static constexpr uint64_t kResultAlignment = 64;
+
+  // Общая память объявлена первой: она создается до `fork()` в конструкторе.
+  SharedArena arena;
   int to_child_read_end;
   int to_child_write_end;
   int to_parent_read_end;
@@ -205,16 +584,42 @@ private:
   // Поле `expects_result` равно true, если вычислитель в данный момент
   // выполняет задачу или есть неполученный результат вычисления.
   bool expects_result = false;
+  std::chrono::nanoseconds busy_time{0};
 };
 
 }
 
-std::vector<std::unique_ptr<AsyncMultiplier>> CreateMultipliers(int count, bool is_threads) {
+const char* ThreadHandoffName(ThreadHandoff handoff) {
+  switch (handoff) {
+    case ThreadHandoff::Mutex:
+      return "mutex";
+    case ThreadHandoff::Atomic:
+      return "atomic";
+    case ThreadHandoff::AtomicSpin:
+      return "spin";
+  }
+  return "unknown";
+}
+
+ThreadHandoff ParseThreadHandoff(const std::string& name) {
+  for (ThreadHandoff handoff : {ThreadHandoff::Mutex, ThreadHandoff::Atomic, ThreadHandoff::AtomicSpin}) {
+    if (name == ThreadHandoffName(handoff)) {
+      return handoff;
+    }
+  }
+  throw std::runtime_error("Unknown thread handoff: " + name + " (expected mutex, atomic or spin)");
+}
+
+std::vector<std::unique_ptr<AsyncMultiplier>> CreateMultipliers(int count, bool is_threads,
+                                                                ThreadHandoff handoff) {
   std::vector<std::unique_ptr<AsyncMultiplier>> result;
   for (int i = 0; i < count; ++i) {
-    if (is_threads) {
+    if (is_threads && handoff == ThreadHandoff::Mutex) {
         result.push_back(std::make_unique<ThreadAcyncMultiplier>());
     }
+    else if (is_threads) {
+        result.push_back(std::make_unique<AtomicAsyncMultiplier>(handoff == ThreadHandoff::AtomicSpin));
+    }
     else {
         result.push_back(std::make_unique<ProcessAsyncMultiplier>());
     }
@@ -1,25 +1,62 @@
+#pragma once
+
+#include <chrono>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
+#include "big_integer.hpp"
+
 // Абстрактный класс асинхронного вычислителя произведения чисел от `from` до
-// `to`.
+// `to`, произведения произвольного набора чисел или произведения отрезка по
+// модулю.
 class AsyncMultiplier {
 public:
   // Вызов метода запускает асинхронное вычисление произедения.
   virtual void SetTask(uint64_t from, uint64_t to) = 0;
+  // Вызов метода запускает асинхронное вычисление произведения чисел из
+  // массива `factors`.
+  virtual void SetFactorsTask(std::vector<uint64_t> factors) = 0;
+  // Вызов метода запускает асинхронное вычисление произведения чисел от
+  // `from` до `to` по модулю `modulus` (см. `RangeProductMod()`). Результат -
+  // остаток, записанный в виде `BigInteger`.
+  virtual void SetModTask(uint64_t from, uint64_t to, uint64_t modulus) = 0;
   // Функция возвращает результат вычисления, запущенного вызовом метода
-  // `SetTask()`. Если асинхронное вычисление еще не завершилось, выполнение
+  // `SetTask()`, `SetFactorsTask()` или `SetModTask()`. Если асинхронное вычисление еще не завершилось, выполнение
   // блокируется до момент появления результата.
-  // Если метод вызывается до какого-либо вызова `SetTask()`, результатом будет
-  // 0. Результат вычисления произведения можно получить лишь единожды, все
-  // последующие вызовы метода будут возвращать 0.
-  virtual uint64_t GetResult() = 0;
+  // Если метод вызывается до какого-либо вызова `SetTask()`, результат будет
+  // пустым. Результат вычисления произведения можно получить лишь единожды,
+  // все последующие вызовы метода будут возвращать пустой результат.
+  virtual std::optional<BigInteger> GetResult() = 0;
+  // Суммарное процессорное время, затраченное вычислителем на задачи,
+  // результаты которых уже получены вызовом `GetResult()`.
+  virtual std::chrono::nanoseconds GetBusyTime() = 0;
   // Завершает выполнение вычислителя и блокирует выполнение до момента
   // завершения выполнения вычислителя.
   virtual void Finish() = 0;
 };
 
+// Способ передачи задач и результатов между главным потоком и
+// вычислителем-потоком.
+enum struct ThreadHandoff {
+  // Мьютекс и условная переменная, общая для обоих направлений.
+  Mutex,
+  // Атомарная ячейка состояния вычислителя: ожидающий поток засыпает в
+  // `std::atomic::wait()` (futex в Linux) и будится `notify_all()`.
+  Atomic,
+  // То же, но перед тем как заснуть, ожидающий поток некоторое время
+  // проверяет ячейку в цикле. Выгодно, только если у ожидающего и
+  // вычисляющего потоков есть свои ядра.
+  AtomicSpin,
+};
+
+// Название способа (`mutex`, `atomic`, `spin`) и способ по названию.
+const char* ThreadHandoffName(ThreadHandoff handoff);
+ThreadHandoff ParseThreadHandoff(const std::string& name);
+
 // Функция, возвращающая массив асинхронных вычислителей. Если `is_threads`
-// истинно, вернется массив вычислителей, использующих потоки. Иначе,
-// вычислители будут использовать процессы.
-std::vector<std::unique_ptr<AsyncMultiplier>> CreateMultipliers(int count, bool is_threads);
+// истинно, вернется массив вычислителей, использующих потоки и способ
+// передачи задач `handoff`. Иначе, вычислители будут использовать процессы.
+std::vector<std::unique_ptr<AsyncMultiplier>> CreateMultipliers(int count, bool is_threads,
+                                                                ThreadHandoff handoff = ThreadHandoff::Mutex);
@@ -0,0 +1,53 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "factorial.hpp"
+#include "multiplier_pool.hpp"
+
+// Программа для сравнения алгоритмов вычисления факториала: для n = 10^4,
+// 10^5, ... замеряется время вычисления `n!` делением отрезка на части и
+// алгоритмом "качающегося факториала", результаты алгоритмов сверяются.
+//
+// Параметры: `bench_factorial [max-n] [number-of-threads]` - наибольшее n (по
+// умолчанию 10^6) и количество вычислителей-потоков (по умолчанию
+// количество логических вычислителей + 1).
+
+namespace {
+
+// Время вычисления в миллисекундах.
+double Measure(uint64_t n, FactorialAlgorithm algorithm, MultiplierPool& pool, BigInteger& result) {
+  auto start = std::chrono::steady_clock::now();
+  result = ComputeFactorial(n, algorithm, WorkPartition::Dynamic, pool);
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+  const uint64_t max_n = argc > 1 ? std::stoull(argv[1]) : 1000000;
+  const int threads = argc > 2 ? std::stoi(argv[2]) : std::thread::hardware_concurrency() + 1;
+  MultiplierPool pool(CreateMultipliers(threads, true));
+
+  int result = 0;
+  std::cout << std::setw(10) << "n" << std::setw(14) << "range, ms" << std::setw(14) << "swing, ms"
+            << std::setw(10) << "speedup" << std::endl;
+  for (uint64_t n = 10000; n <= max_n; n *= 10) {
+    BigInteger range_result;
+    BigInteger swing_result;
+    const double range_time = Measure(n, FactorialAlgorithm::RangeSplit, pool, range_result);
+    const double swing_time = Measure(n, FactorialAlgorithm::PrimeSwing, pool, swing_result);
+    std::cout << std::setw(10) << n << std::fixed << std::setprecision(1) << std::setw(14)
+              << range_time << std::setw(14) << swing_time << std::setw(10) << std::setprecision(2)
+              << range_time / swing_time << std::endl;
+    if (range_result.Limbs() != swing_result.Limbs()) {
+      std::cout << "Mismatch for n = " << n << std::endl;
+      result = 1;
+      break;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,162 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "limb_kernels.hpp"
+
+// Программа для сравнения реализаций внутренних циклов умножения
+// (`task5/limb_kernels.hpp`). Сначала результаты всех поддерживаемых
+// процессором реализаций сверяются со скалярной на множителях разных
+// размеров, в том числе из одних единичных битов (с наибольшими переносами).
+// Затем замеряется время умножения "в столбик" равных по длине чисел и
+// умножения числа на цифру каждой реализацией.
+//
+// Параметры: `bench_kernels [--check]` - только сверить результаты.
+
+namespace {
+
+using Limbs = std::vector<uint32_t>;
+
+const LimbKernel kKernels[] = {LimbKernel::Scalar, LimbKernel::Avx2, LimbKernel::Avx512Ifma};
+
+Limbs RandomLimbs(std::mt19937& random, size_t size, bool all_ones) {
+  Limbs result(size);
+  for (uint32_t& limb : result) {
+    limb = all_ones ? 0xffffffff : random();
+  }
+  return result;
+}
+
+Limbs Basecase(LimbKernel kernel, const Limbs& lhs, const Limbs& rhs) {
+  SetLimbKernel(kernel);
+  Limbs result(lhs.size() + rhs.size());
+  MultiplyBasecase(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result.data());
+  return result;
+}
+
+Limbs ByWord(LimbKernel kernel, Limbs value, uint32_t factor) {
+  SetLimbKernel(kernel);
+  value.push_back(MultiplyByWord(value.data(), value.size(), factor));
+  return value;
+}
+
+bool CrossCheck(std::mt19937& random) {
+  std::vector<size_t> sizes;
+  for (size_t size = 1; size <= 40; ++size) {
+    sizes.push_back(size);
+  }
+  for (size_t size : {63, 64, 65, 100, 1023, 1024, 1025, 2500}) {
+    sizes.push_back(size);
+  }
+  for (bool all_ones : {false, true}) {
+    for (size_t lhs_size : sizes) {
+      for (size_t rhs_size : sizes) {
+        // Большие множители сверяются выборочно.
+        if (lhs_size * rhs_size > 100000 && lhs_size != rhs_size && lhs_size > 8 && rhs_size > 8) {
+          continue;
+        }
+        const Limbs lhs = RandomLimbs(random, lhs_size, all_ones);
+        const Limbs rhs = RandomLimbs(random, rhs_size, all_ones);
+        const uint32_t factor = all_ones ? 0xffffffff : random();
+        const Limbs expected = Basecase(LimbKernel::Scalar, lhs, rhs);
+        const Limbs expected_by_word = ByWord(LimbKernel::Scalar, lhs, factor);
+        for (LimbKernel kernel : kKernels) {
+          if (!IsLimbKernelSupported(kernel)) {
+            continue;
+          }
+          if (Basecase(kernel, lhs, rhs) != expected) {
+            std::cout << "Mismatch: " << LimbKernelName(kernel) << " basecase " << lhs_size << "x"
+                      << rhs_size << std::endl;
+            return false;
+          }
+          if (ByWord(kernel, lhs, factor) != expected_by_word) {
+            std::cout << "Mismatch: " << LimbKernelName(kernel) << " by word " << lhs_size << std::endl;
+            return false;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// Время одного вызова `run()` в наносекундах (минимум по нескольким сериям).
+template <typename Run>
+double Measure(Run run) {
+  double best = 1e18;
+  auto total_start = std::chrono::steady_clock::now();
+  for (int series = 0; series < 3 || std::chrono::steady_clock::now() - total_start < std::chrono::milliseconds(30);
+       ++series) {
+    const int calls = 100;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+      run();
+    }
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count() / calls);
+  }
+  return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const bool check_only = argc > 1 && std::string(argv[1]) == "--check";
+  const LimbKernel detected = DetectLimbKernel();
+  std::cout << "Detected kernel: " << LimbKernelName(detected) << std::endl;
+  std::mt19937 random(12345);
+  if (!CrossCheck(random)) {
+    return 1;
+  }
+  std::cout << "Cross-check passed" << std::endl;
+  if (check_only) {
+    return 0;
+  }
+
+  std::cout << "Basecase, ns:\n  " << std::setw(6) << "limbs";
+  for (LimbKernel kernel : kKernels) {
+    std::cout << std::setw(10) << LimbKernelName(kernel);
+  }
+  std::cout << "\n";
+  for (size_t size : {4, 8, 12, 16, 24, 32, 48, 64, 96, 128}) {
+    const Limbs lhs = RandomLimbs(random, size, false);
+    const Limbs rhs = RandomLimbs(random, size, false);
+    Limbs result(2 * size);
+    std::cout << "  " << std::setw(6) << size;
+    for (LimbKernel kernel : kKernels) {
+      if (!IsLimbKernelSupported(kernel)) {
+        std::cout << std::setw(10) << "-";
+        continue;
+      }
+      SetLimbKernel(kernel);
+      std::cout << std::setw(10) << std::fixed << std::setprecision(0)
+                << Measure([&]() { MultiplyBasecase(lhs.data(), size, rhs.data(), size, result.data()); });
+    }
+    std::cout << "\n";
+  }
+
+  std::cout << "Multiply by word, ns:\n  " << std::setw(6) << "limbs";
+  for (LimbKernel kernel : kKernels) {
+    std::cout << std::setw(10) << LimbKernelName(kernel);
+  }
+  std::cout << "\n";
+  for (size_t size : {16, 64, 256, 1024, 4096}) {
+    Limbs value = RandomLimbs(random, size, false);
+    std::cout << "  " << std::setw(6) << size;
+    for (LimbKernel kernel : kKernels) {
+      if (!IsLimbKernelSupported(kernel)) {
+        std::cout << std::setw(10) << "-";
+        continue;
+      }
+      SetLimbKernel(kernel);
+      std::cout << std::setw(10) << std::fixed << std::setprecision(0)
+                << Measure([&]() { MultiplyByWord(value.data(), size, 0x9e3779b9); });
+    }
+    std::cout << "\n";
+  }
+  SetLimbKernel(detected);
+  return 0;
+}
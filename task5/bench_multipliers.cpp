@@ -0,0 +1,75 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "async_multiplier.hpp"
+
+// Программа для сравнения вычислителей-потоков (с каждым способом передачи
+// задач, см. `ThreadHandoff`) и вычислителей-процессов
+// (`task5/async_multiplier.hpp`): для результатов разной длины замеряется
+// время полного цикла "задача - результат" одного вычислителя за вычетом
+// времени самого вычисления (`GetBusyTime()`), то есть стоимость передачи
+// задачи и результата. Результат длины n цифр - произведение n / 2 чисел,
+// больших 2^63; для результата из одной цифры это задержка передачи
+// крошечной задачи туда и обратно.
+//
+// Параметры: `bench_multipliers [max-limbs]` - наибольшая длина результата
+// (по умолчанию 10^5 цифр).
+
+namespace {
+
+// Время одного цикла "задача - результат" без времени вычисления в
+// микросекундах (минимум по нескольким сериям).
+double Measure(AsyncMultiplier& multiplier, uint64_t limbs) {
+  const uint64_t from = (uint64_t)1 << 63;
+  const uint64_t to = limbs < 2 ? from : from + limbs / 2 - 1;
+  double best = 1e18;
+  auto total_start = std::chrono::steady_clock::now();
+  for (int series = 0; series < 3 || std::chrono::steady_clock::now() - total_start < std::chrono::milliseconds(500);
+       ++series) {
+    const int calls = limbs < 10000 ? 100 : 1;
+    const std::chrono::nanoseconds busy_start = multiplier.GetBusyTime();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; ++i) {
+      multiplier.SetTask(from, to);
+      multiplier.GetResult();
+    }
+    auto end = std::chrono::steady_clock::now();
+    const auto busy = multiplier.GetBusyTime() - busy_start;
+    best = std::min(best, std::chrono::duration<double, std::micro>(end - start - busy).count() / calls);
+  }
+  return best;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const uint64_t max_limbs = argc > 1 ? std::stoull(argv[1]) : 100000;
+  std::vector<std::string> names;
+  std::vector<std::unique_ptr<AsyncMultiplier>> multipliers;
+  for (ThreadHandoff handoff : {ThreadHandoff::Mutex, ThreadHandoff::Atomic, ThreadHandoff::AtomicSpin}) {
+    names.push_back(ThreadHandoffName(handoff));
+    multipliers.push_back(std::move(CreateMultipliers(1, true, handoff)[0]));
+  }
+  names.push_back("processes");
+  multipliers.push_back(std::move(CreateMultipliers(1, false)[0]));
+
+  std::cout << "Round trip without computation, us:\n" << std::setw(10) << "limbs";
+  for (const std::string& name : names) {
+    std::cout << std::setw(12) << name;
+  }
+  std::cout << std::endl;
+  for (uint64_t limbs = 1; limbs <= max_limbs; limbs *= 10) {
+    std::cout << std::setw(10) << limbs;
+    for (auto& multiplier : multipliers) {
+      std::cout << std::setw(12) << std::fixed << std::setprecision(1) << Measure(*multiplier, limbs);
+    }
+    std::cout << std::endl;
+  }
+  for (auto& multiplier : multipliers) {
+    multiplier->Finish();
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "limb_kernels.hpp"
+#include "multiplication.hpp"
+
+// Программа для подбора порогов выбора алгоритма умножения. Для множителей
+// растущего размера замеряется время умножения каждым алгоритмом (алгоритм
+// задается только на верхнем уровне, вложенные умножения выбираются по
+// текущим порогам), результаты алгоритмов сверяются друг с другом. Порог
+// алгоритма - наименьший размер, начиная с которого алгоритм быстрее
+// предыдущего. Пороги подбираются последовательно: Карацуба сравнивается с
+// умножением "в столбик", затем Тоом-Кук с Карацубой при найденном пороге
+// Карацубы и т.д.
+//
+// Параметры: `bench_multiply [max-size]` - наибольший размер множителей в
+// 32-битных цифрах (по умолчанию 16384). Реализацию внутренних циклов можно
+// задать переменной среды `LIMB_KERNEL` (`scalar`, `avx2` или `ifma`).
+
+namespace {
+
+using Limbs = std::vector<uint32_t>;
+
+const char* kAlgorithmNames[] = {"schoolbook", "karatsuba", "toom3", "ntt"};
+
+Limbs RandomLimbs(std::mt19937& random, size_t size) {
+  Limbs result(size);
+  for (uint32_t& limb : result) {
+    limb = random();
+  }
+  result.back() |= 1u << 31;
+  return result;
+}
+
+// Время одного умножения в микросекундах (минимум по нескольким запускам).
+double Measure(MultiplicationAlgorithm algorithm, const Limbs& lhs, const Limbs& rhs) {
+  double best = 1e18;
+  int repetitions = 0;
+  auto total_start = std::chrono::steady_clock::now();
+  // Повторяем замер, пока не наберется хотя бы 3 запуска и 50 мс.
+  while (repetitions < 3 || std::chrono::steady_clock::now() - total_start < std::chrono::milliseconds(50)) {
+    auto start = std::chrono::steady_clock::now();
+    Limbs result = MultiplyLimbsWith(algorithm, lhs, rhs);
+    auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::micro>(end - start).count());
+    ++repetitions;
+  }
+  return best;
+}
+
+// Находит наименьший размер из `sizes`, начиная с которого `algorithm`
+// быстрее `previous` на всех больших размерах.
+size_t FindThreshold(std::mt19937& random, MultiplicationAlgorithm previous,
+                     MultiplicationAlgorithm algorithm, const std::vector<size_t>& sizes) {
+  size_t threshold = sizes.back() * 2;
+  std::cout << kAlgorithmNames[(int)previous] << " vs " << kAlgorithmNames[(int)algorithm] << ":\n";
+  for (size_t i = sizes.size(); i-- > 0;) {
+    Limbs lhs = RandomLimbs(random, sizes[i]);
+    Limbs rhs = RandomLimbs(random, sizes[i]);
+    const double previous_time = Measure(previous, lhs, rhs);
+    const double time = Measure(algorithm, lhs, rhs);
+    std::cout << "  " << std::setw(7) << sizes[i] << " limbs: " << std::setw(12) << std::fixed
+              << std::setprecision(1) << previous_time << " us " << std::setw(12) << time << " us\n";
+    if (time > previous_time) {
+      break;
+    }
+    threshold = sizes[i];
+  }
+  return threshold;
+}
+
+// Сверяет результаты всех алгоритмов на случайных множителях разных
+// размеров, в том числе сильно различающихся.
+bool CrossCheck(std::mt19937& random) {
+  const size_t sizes[] = {1, 2, 3, 7, 31, 64, 100, 257, 1000, 3001};
+  for (size_t lhs_size : sizes) {
+    for (size_t rhs_size : sizes) {
+      Limbs lhs = RandomLimbs(random, lhs_size);
+      Limbs rhs = RandomLimbs(random, rhs_size);
+      Limbs expected = MultiplyLimbsWith(MultiplicationAlgorithm::Schoolbook, lhs, rhs);
+      for (auto algorithm : {MultiplicationAlgorithm::Karatsuba, MultiplicationAlgorithm::Toom3,
+                             MultiplicationAlgorithm::Ntt}) {
+        if (MultiplyLimbsWith(algorithm, lhs, rhs) != expected) {
+          std::cout << "Mismatch: " << kAlgorithmNames[(int)algorithm] << " " << lhs_size << "x"
+                    << rhs_size << std::endl;
+          return false;
+        }
+      }
+      if (MultiplyLimbs(lhs, rhs, 4) != expected) {
+        std::cout << "Mismatch: parallel " << lhs_size << "x" << rhs_size << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+  const size_t max_size = argc > 1 ? std::stoull(argv[1]) : 16384;
+  // Пороги подбираются для реализации внутренних циклов из переменной среды
+  // LIMB_KERNEL или для наилучшей поддерживаемой процессором.
+  char* kernel_var = getenv("LIMB_KERNEL");
+  if (kernel_var != NULL) {
+    SetLimbKernel(ParseLimbKernel(kernel_var));
+  }
+  SetMultiplicationThresholds(DefaultMultiplicationThresholds(GetLimbKernel()));
+  std::cout << "Limb kernel: " << LimbKernelName(GetLimbKernel()) << std::endl;
+  std::mt19937 random(12345);
+  if (!CrossCheck(random)) {
+    return 1;
+  }
+  std::cout << "Cross-check passed" << std::endl;
+
+  std::vector<size_t> sizes;
+  for (size_t size = 8; size <= max_size; size = size * 5 / 4 + 1) {
+    sizes.push_back(size);
+  }
+  MultiplicationThresholds thresholds = GetMultiplicationThresholds();
+  // Пока подбирается порог одного алгоритма, следующие отключены.
+  thresholds.toom3 = thresholds.ntt = SIZE_MAX;
+  SetMultiplicationThresholds(thresholds);
+  thresholds.karatsuba = FindThreshold(random, MultiplicationAlgorithm::Schoolbook,
+                                       MultiplicationAlgorithm::Karatsuba, sizes);
+  SetMultiplicationThresholds(thresholds);
+  thresholds.toom3 = FindThreshold(random, MultiplicationAlgorithm::Karatsuba,
+                                   MultiplicationAlgorithm::Toom3, sizes);
+  SetMultiplicationThresholds(thresholds);
+  thresholds.ntt = FindThreshold(random, MultiplicationAlgorithm::Toom3,
+                                 MultiplicationAlgorithm::Ntt, sizes);
+  std::cout << "Thresholds: karatsuba " << thresholds.karatsuba << ", toom3 " << thresholds.toom3
+            << ", ntt " << thresholds.ntt << std::endl;
+  return 0;
+}
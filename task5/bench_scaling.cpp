@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "factorial.hpp"
+#include "multiplier_pool.hpp"
+
+// Программа для замера масштабирования вычисления факториалов: для каждого
+// вида вычислителей (потоки, процессы), количества вычислителей от 1 до
+// `max-workers` (степени двойки и само `max-workers`) и набора запросов все
+// запросы набора запускаются одновременно (`ComputeFactorialAsync()`,
+// алгоритм `range`, разбиение `dynamic`, без кэша и без перевода в
+// десятичную запись). Каждый замер повторяется `repetitions` раз после
+// одного прогревочного запуска.
+//
+// Результаты выводятся в stdout в формате CSV, по строке на замер:
+// - `latency_*_ms` - время от запуска запроса до получения его результата
+//   (среднее, медиана и максимум по всем повторениям);
+// - `queries_per_sec` - количество запросов, деленное на медиану времени
+//   вычисления всего набора;
+// - `speedup` - отношение `queries_per_sec` к значению для одного
+//   вычислителя того же вида, `efficiency` - `speedup`, деленный на
+//   количество вычислителей.
+//
+// Параметры: `bench_scaling [max-workers] [repetitions]` - по умолчанию
+// удвоенное количество логических вычислителей и 3 повторения.
+
+namespace {
+
+// Набор из `queries` одинаковых запросов `n`.
+struct Workload {
+  uint64_t n;
+  size_t queries;
+};
+
+const Workload kWorkloads[] = {{1000, 400}, {20000, 40}, {200000, 4}};
+
+// Время вычисления набора и задержки его запросов в миллисекундах.
+struct Run {
+  double time;
+  std::vector<double> latencies;
+};
+
+Run RunWorkload(MultiplierPool& pool, const Workload& workload) {
+  using Clock = std::chrono::steady_clock;
+  Run run;
+  std::mutex mutex;
+  const Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < workload.queries; ++i) {
+    const Clock::time_point submitted = Clock::now();
+    ComputeFactorialAsync(workload.n, FactorialAlgorithm::RangeSplit, WorkPartition::Dynamic, pool,
+                          [submitted, &run, &mutex](BigInteger) {
+      const double latency = std::chrono::duration<double, std::milli>(Clock::now() - submitted).count();
+      std::unique_lock lock(mutex);
+      run.latencies.push_back(latency);
+    });
+  }
+  pool.Wait();
+  run.time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  return run;
+}
+
+double Median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+}
+
+int main(int argc, char** argv) {
+  const int max_workers = argc > 1 ? std::stoi(argv[1]) : 2 * std::max(1u, std::thread::hardware_concurrency());
+  const int repetitions = argc > 2 ? std::stoi(argv[2]) : 3;
+  std::vector<int> worker_counts;
+  for (int workers = 1; workers < max_workers; workers *= 2) {
+    worker_counts.push_back(workers);
+  }
+  worker_counts.push_back(max_workers);
+
+  std::cout << "backend,workers,n,queries,repetitions,latency_mean_ms,latency_p50_ms,latency_max_ms,"
+            << "queries_per_sec,speedup,efficiency" << std::endl;
+  for (bool is_threads : {true, false}) {
+    const char* backend = is_threads ? "threads" : "processes";
+    // Производительность одного вычислителя для каждого набора запросов.
+    std::vector<double> base_rate(std::size(kWorkloads));
+    for (int workers : worker_counts) {
+      MultiplierPool pool(CreateMultipliers(workers, is_threads));
+      for (size_t w = 0; w < std::size(kWorkloads); ++w) {
+        const Workload& workload = kWorkloads[w];
+        std::cerr << backend << ", " << workers << " workers, " << workload.queries << " x " << workload.n
+                  << "!" << std::endl;
+        RunWorkload(pool, workload);
+        std::vector<double> times;
+        std::vector<double> latencies;
+        for (int i = 0; i < repetitions; ++i) {
+          Run run = RunWorkload(pool, workload);
+          times.push_back(run.time);
+          latencies.insert(latencies.end(), run.latencies.begin(), run.latencies.end());
+        }
+        double latency_sum = 0;
+        for (double latency : latencies) {
+          latency_sum += latency;
+        }
+        const double rate = workload.queries * 1000.0 / Median(times);
+        if (workers == 1) {
+          base_rate[w] = rate;
+        }
+        const double speedup = rate / base_rate[w];
+        std::cout << backend << "," << workers << "," << workload.n << "," << workload.queries << ","
+                  << repetitions << std::fixed << std::setprecision(3) << "," << latency_sum / latencies.size()
+                  << "," << Median(latencies) << "," << *std::max_element(latencies.begin(), latencies.end())
+                  << "," << rate << "," << speedup << "," << speedup / workers << std::endl;
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,198 @@
+#include "big_integer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "limb_kernels.hpp"
+#include "multiplication.hpp"
+#include "parallel.hpp"
+#include "radix.hpp"
+
+BigInteger::BigInteger(uint64_t value) {
+  while (value > 0) {
+    limbs.push_back((Limb)value);
+    value >>= 32;
+  }
+}
+
+BigInteger BigInteger::FromLimbs(std::vector<Limb> limbs) {
+  BigInteger result;
+  result.limbs = std::move(limbs);
+  result.Normalize();
+  return result;
+}
+
+size_t BigInteger::BitLength() const {
+  if (limbs.empty()) {
+    return 0;
+  }
+  return limbs.size() * 32 - __builtin_clz(limbs.back());
+}
+
+BigInteger& BigInteger::operator*=(Limb factor) {
+  const Limb carry = MultiplyByWord(limbs.data(), limbs.size(), factor);
+  if (carry > 0) {
+    limbs.push_back(carry);
+  }
+  Normalize();
+  return *this;
+}
+
+BigInteger& BigInteger::operator*=(const BigInteger& other) {
+  *this = *this * other;
+  return *this;
+}
+
+BigInteger& BigInteger::operator<<=(size_t bits) {
+  if (IsZero()) {
+    return *this;
+  }
+  const size_t limb_shift = bits / 32;
+  const int bit_shift = bits % 32;
+  limbs.insert(limbs.begin(), limb_shift, 0);
+  if (bit_shift > 0) {
+    Limb carry = 0;
+    for (size_t i = limb_shift; i < limbs.size(); ++i) {
+      const Limb next_carry = limbs[i] >> (32 - bit_shift);
+      limbs[i] = (limbs[i] << bit_shift) | carry;
+      carry = next_carry;
+    }
+    if (carry > 0) {
+      limbs.push_back(carry);
+    }
+  }
+  return *this;
+}
+
+BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs) {
+  return Multiply(lhs, rhs);
+}
+
+BigInteger Multiply(const BigInteger& lhs, const BigInteger& rhs, int threads) {
+  if (lhs.IsZero() || rhs.IsZero()) {
+    return BigInteger();
+  }
+  return BigInteger::FromLimbs(MultiplyLimbs(lhs.Limbs(), rhs.Limbs(), threads));
+}
+
+std::string BigInteger::ToString() const {
+  return ToDecimalString(*this);
+}
+
+void BigInteger::Normalize() {
+  while (!limbs.empty() && limbs.back() == 0) {
+    limbs.pop_back();
+  }
+}
+
+std::ostream& operator<<(std::ostream& out, const BigInteger& value) {
+  return out << value.ToString();
+}
+
+namespace {
+
+// Один уровень дерева произведений: соседние числа перемножаются попарно.
+void MultiplyPairs(std::vector<BigInteger>& values, int threads) {
+  // Умножения одного уровня независимы и распределяются между потоками.
+  // Когда пар на уровне меньше, чем потоков, оставшиеся потоки отдаются
+  // самим умножениям.
+  const size_t pairs = values.size() / 2;
+  const int threads_per_pair = std::max<int>(1, threads / pairs);
+  std::vector<BigInteger> next((values.size() + 1) / 2);
+  ParallelFor(pairs, threads, [&](size_t i) {
+    next[i] = Multiply(values[2 * i], values[2 * i + 1], threads_per_pair);
+  });
+  if (values.size() % 2 == 1) {
+    next.back() = std::move(values.back());
+  }
+  values = std::move(next);
+}
+
+}
+
+BigInteger ProductTree(std::vector<BigInteger> values, int threads) {
+  if (values.empty()) {
+    return BigInteger(1);
+  }
+  while (values.size() > 1) {
+    MultiplyPairs(values, threads);
+  }
+  return std::move(values.front());
+}
+
+namespace {
+
+// Собирает множители, которые по очереди выдает `next_factor()`, в слова,
+// пока произведение помещается в 64 бита.
+template <typename NextFactor>
+std::vector<BigInteger> PackWords(size_t count, NextFactor next_factor) {
+  std::vector<BigInteger> words;
+  uint64_t word = 1;
+  for (size_t i = 0; i < count; ++i) {
+    const uint64_t factor = next_factor();
+    uint64_t product;
+    if (__builtin_mul_overflow(word, factor, &product)) {
+      words.emplace_back(word);
+      word = factor;
+    }
+    else {
+      word = product;
+    }
+  }
+  words.emplace_back(word);
+  return words;
+}
+
+// Перемножает слова деревом, как `ProductTree()`, но последнее умножение
+// записывает цифры сразу в буфер `allocate()`.
+size_t ProductTreeInto(std::vector<BigInteger> words, const LimbAllocator& allocate) {
+  while (words.size() > 2) {
+    MultiplyPairs(words, 1);
+  }
+  const std::vector<BigInteger::Limb>& lhs = words.front().Limbs();
+  size_t size;
+  BigInteger::Limb* result;
+  if (words.size() == 1) {
+    size = lhs.size();
+    result = allocate(size);
+    std::copy(lhs.begin(), lhs.end(), result);
+  }
+  else {
+    const std::vector<BigInteger::Limb>& rhs = words.back().Limbs();
+    size = lhs.size() + rhs.size();
+    result = allocate(size);
+    MultiplyLimbsInto(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result);
+  }
+  while (size > 0 && result[size - 1] == 0) {
+    --size;
+  }
+  return size;
+}
+
+}
+
+BigInteger RangeProduct(uint64_t from, uint64_t to) {
+  if (from > to) {
+    throw std::runtime_error("`to` should be equal or greater than `from`");
+  }
+  uint64_t next = from;
+  return ProductTree(PackWords(to - from + 1, [&next]() { return next++; }));
+}
+
+BigInteger ListProduct(const std::vector<uint64_t>& factors) {
+  size_t index = 0;
+  return ProductTree(PackWords(factors.size(), [&]() { return factors[index++]; }));
+}
+
+size_t RangeProductInto(uint64_t from, uint64_t to, const LimbAllocator& allocate) {
+  if (from > to) {
+    throw std::runtime_error("`to` should be equal or greater than `from`");
+  }
+  uint64_t next = from;
+  return ProductTreeInto(PackWords(to - from + 1, [&next]() { return next++; }), allocate);
+}
+
+size_t ListProductInto(const uint64_t* factors, size_t count, const LimbAllocator& allocate) {
+  size_t index = 0;
+  return ProductTreeInto(PackWords(count, [&]() { return factors[index++]; }), allocate);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Неотрицательное целое число произвольной длины. Число хранится массивом
+// 32-битных "цифр" (limbs) в порядке от младшей к старшей, старшая цифра
+// всегда ненулевая, а ноль представляется пустым массивом.
+class BigInteger {
+public:
+  using Limb = uint32_t;
+
+  BigInteger() = default;
+  BigInteger(uint64_t value);
+
+  // Создает число из массива цифр, отбрасывая старшие нулевые цифры.
+  static BigInteger FromLimbs(std::vector<Limb> limbs);
+
+  const std::vector<Limb>& Limbs() const { return limbs; }
+  bool IsZero() const { return limbs.empty(); }
+  // Количество значащих бит числа.
+  size_t BitLength() const;
+
+  // Умножение на одну цифру.
+  BigInteger& operator*=(Limb factor);
+  BigInteger& operator*=(const BigInteger& other);
+  // Умножение на 2^bits.
+  BigInteger& operator<<=(size_t bits);
+  friend BigInteger operator*(const BigInteger& lhs, const BigInteger& rhs);
+
+  bool operator==(const BigInteger& other) const = default;
+
+  // Десятичная запись числа (см. `ToDecimalString()`).
+  std::string ToString() const;
+
+private:
+  // Отбрасывает старшие нулевые цифры.
+  void Normalize();
+
+  std::vector<Limb> limbs;
+};
+
+std::ostream& operator<<(std::ostream& out, const BigInteger& value);
+
+// Произведение, вычисляемое в `threads` потоках (см. `MultiplyLimbs()`).
+BigInteger Multiply(const BigInteger& lhs, const BigInteger& rhs, int threads = 1);
+
+// Произведение всех чисел массива. Числа перемножаются сбалансированным
+// деревом: на каждом уровне соседние числа перемножаются попарно, поэтому
+// множители каждого умножения имеют близкие размеры. Умножения выполняются в
+// `threads` потоках. Произведение пустого массива равно 1.
+BigInteger ProductTree(std::vector<BigInteger> values, int threads = 1);
+
+// Произведение чисел от `from` до `to` включительно. Идущие подряд множители
+// сначала собираются в 64-битные слова, а слова перемножаются деревом
+// `ProductTree()`.
+BigInteger RangeProduct(uint64_t from, uint64_t to);
+
+// Произведение чисел из массива `factors`, вычисляемое так же, как
+// `RangeProduct()`. Произведение пустого массива равно 1.
+BigInteger ListProduct(const std::vector<uint64_t>& factors);
+
+// Выделяет буфер из `size` цифр, куда записывается произведение, и
+// возвращает указатель на него.
+using LimbAllocator = std::function<BigInteger::Limb*(size_t size)>;
+
+// То же, что `RangeProduct()` и `ListProduct()`, но последнее умножение
+// дерева записывает цифры произведения сразу в буфер `allocate(size)`, минуя
+// промежуточное число. Буфер запрашивается один раз, после того как все
+// множители прочитаны. Возвращает количество значащих цифр произведения
+// (остальные цифры буфера нулевые).
+size_t RangeProductInto(uint64_t from, uint64_t to, const LimbAllocator& allocate);
+size_t ListProductInto(const uint64_t* factors, size_t count, const LimbAllocator& allocate);
@@ -0,0 +1,118 @@
+#include "coroutines.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+void Coroutine::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+  CoroutineExecutor* executor = handle.promise().executor;
+  handle.destroy();
+  --executor->active;
+}
+
+void Coroutine::promise_type::unhandled_exception() {
+  if (!executor->error) {
+    executor->error = std::current_exception();
+  }
+}
+
+CoroutineExecutor::CoroutineExecutor() : ready_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+  if (ready_fd == -1) {
+    throw std::runtime_error(strerror(errno));
+  }
+}
+
+CoroutineExecutor::~CoroutineExecutor() {
+  close(ready_fd);
+}
+
+void CoroutineExecutor::Spawn(Coroutine coroutine) {
+  std::coroutine_handle<Coroutine::promise_type> handle = std::exchange(coroutine.handle, nullptr);
+  handle.promise().executor = this;
+  ++active;
+  Resume({handle});
+}
+
+void CoroutineExecutor::Post(std::coroutine_handle<> handle) {
+  std::unique_lock lock(mutex);
+  ready.push_back(handle);
+  lock.unlock();
+  has_ready.notify_one();
+  const uint64_t one = 1;
+  if (write(ready_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+    throw std::runtime_error(strerror(errno));
+  }
+}
+
+void CoroutineExecutor::RunReady() {
+  // Сбрасываем счетчик eventfd до того, как забрать очередь: сопрограмма,
+  // поставленная в очередь позже, снова сделает его ненулевым.
+  uint64_t count;
+  if (read(ready_fd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+    throw std::runtime_error(strerror(errno));
+  }
+  std::unique_lock lock(mutex);
+  std::deque<std::coroutine_handle<>> handles = std::move(ready);
+  ready.clear();
+  lock.unlock();
+  Resume(std::move(handles));
+}
+
+void CoroutineExecutor::Run() {
+  while (active > 0) {
+    std::unique_lock lock(mutex);
+    has_ready.wait(lock, [this]() { return !ready.empty(); });
+    std::deque<std::coroutine_handle<>> handles = std::move(ready);
+    ready.clear();
+    lock.unlock();
+    Resume(std::move(handles));
+  }
+}
+
+void CoroutineExecutor::Resume(std::deque<std::coroutine_handle<>> handles) {
+  for (std::coroutine_handle<> handle : handles) {
+    handle.resume();
+  }
+  if (error) {
+    std::rethrow_exception(std::exchange(error, nullptr));
+  }
+}
+
+Awaitable<BigInteger> AwaitRangeProduct(CoroutineExecutor& executor, MultiplierPool& pool, uint64_t from,
+                                        uint64_t to) {
+  return Awaitable<BigInteger>(executor, [&pool, from, to](Awaitable<BigInteger>& awaitable) {
+    pool.Submit([&awaitable, from, to](AsyncMultiplier& multiplier) {
+      std::optional<BigInteger> result;
+      try {
+        multiplier.SetTask(from, to);
+        result = multiplier.GetResult();
+      }
+      catch (...) {
+        awaitable.Fail(std::current_exception());
+        return;
+      }
+      awaitable.Complete(std::move(*result));
+    });
+  });
+}
+
+Awaitable<BigInteger> AwaitFactorial(CoroutineExecutor& executor, uint64_t n, FactorialAlgorithm algorithm,
+                                     WorkPartition partition, MultiplierPool& pool, FactorialCache* cache) {
+  return Awaitable<BigInteger>(executor, [=, &pool](Awaitable<BigInteger>& awaitable) {
+    ComputeFactorialAsync(
+        n, algorithm, partition, pool, [&awaitable](BigInteger result) { awaitable.Complete(std::move(result)); },
+        cache, [&awaitable](std::exception_ptr error) { awaitable.Fail(error); });
+  });
+}
+
+Awaitable<uint64_t> AwaitFactorialMod(CoroutineExecutor& executor, uint64_t n, uint64_t modulus,
+                                      MultiplierPool& pool) {
+  return Awaitable<uint64_t>(executor, [=, &pool](Awaitable<uint64_t>& awaitable) {
+    ComputeFactorialModAsync(
+        n, modulus, pool, [&awaitable](uint64_t result) { awaitable.Complete(result); },
+        [&awaitable](std::exception_ptr error) { awaitable.Fail(error); });
+  });
+}
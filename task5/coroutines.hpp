@@ -0,0 +1,183 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "big_integer.hpp"
+#include "factorial.hpp"
+#include "multiplier_pool.hpp"
+
+class CoroutineExecutor;
+
+// Сопрограмма, запускаемая исполнителем (`CoroutineExecutor::Spawn()`).
+// Результата не возвращает; после завершения уничтожается сама.
+class Coroutine {
+public:
+  struct promise_type {
+    // Сообщает исполнителю о завершении сопрограммы и уничтожает ее.
+    struct FinalAwaiter {
+      bool await_ready() const noexcept { return false; }
+      void await_suspend(std::coroutine_handle<promise_type> handle) noexcept;
+      void await_resume() const noexcept {}
+    };
+
+    Coroutine get_return_object() { return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    // Сопрограмма начинает выполняться только при `Spawn()`.
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception();
+
+    CoroutineExecutor* executor = nullptr;
+  };
+
+  Coroutine(Coroutine&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+  Coroutine(const Coroutine&) = delete;
+  Coroutine& operator=(const Coroutine&) = delete;
+  // Сопрограмма, так и не переданная исполнителю, уничтожается.
+  ~Coroutine() {
+    if (handle) {
+      handle.destroy();
+    }
+  }
+
+private:
+  friend class CoroutineExecutor;
+
+  explicit Coroutine(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+// Однопоточный исполнитель сопрограмм. Все сопрограммы выполняются в потоке,
+// вызывающем `Spawn()`, `RunReady()` и `Run()`. Сопрограмма, ожидающая
+// асинхронной операции (`Awaitable`), приостанавливается, а когда операция
+// завершается в другом потоке (например, в потоке пула вычислителей), она
+// ставится в очередь исполнителя и возобновляется при следующем вызове
+// `RunReady()` или `Run()`. Поэтому один поток может ожидать любое количество
+// вычислений одновременно.
+class CoroutineExecutor {
+public:
+  CoroutineExecutor();
+  ~CoroutineExecutor();
+  CoroutineExecutor(const CoroutineExecutor&) = delete;
+  CoroutineExecutor& operator=(const CoroutineExecutor&) = delete;
+
+  // Дескриптор eventfd, доступный для чтения, пока в очереди есть
+  // сопрограммы, готовые к возобновлению (до следующего `RunReady()`).
+  // Позволяет ждать их через `poll()` вместе с другими дескрипторами,
+  // например со stdin.
+  int ReadyFd() const { return ready_fd; }
+
+  // Запускает сопрограмму: она выполняется до первой приостановки.
+  void Spawn(Coroutine coroutine);
+  // Ставит приостановленную сопрограмму в очередь на возобновление. Метод
+  // можно вызывать из любого потока.
+  void Post(std::coroutine_handle<> handle);
+  // Возобновляет сопрограммы из очереди, не дожидаясь новых.
+  void RunReady();
+  // Возобновляет сопрограммы, пока не завершатся все запущенные. Если
+  // какая-либо сопрограмма завершилась исключением, оно пробрасывается
+  // (первое из них).
+  void Run();
+
+private:
+  friend struct Coroutine::promise_type;
+
+  // Возобновляет сопрограммы из `handles` и пробрасывает исключение, если
+  // какая-либо из сопрограмм им завершилась.
+  void Resume(std::deque<std::coroutine_handle<>> handles);
+
+  // Очередь готовых к возобновлению сопрограмм пополняется из любых потоков
+  // и защищена мьютексом. Остальные поля используются только потоком
+  // исполнителя: `active` - количество запущенных и не завершившихся
+  // сопрограмм. В `ready_fd` при каждом `Post()` записывается 1.
+  std::mutex mutex;
+  std::condition_variable has_ready;
+  std::deque<std::coroutine_handle<>> ready;
+  size_t active = 0;
+  std::exception_ptr error;
+  int ready_fd;
+};
+
+// Асинхронная операция, которую может ожидать сопрограмма (`co_await`).
+// При приостановке сопрограммы вызывается `start(*this)`; операция
+// завершается вызовом `Complete(value)` или `Fail(error)` из любого потока,
+// после чего сопрограмма возобновляется исполнителем `executor`, и
+// `co_await` возвращает `value` или пробрасывает `error`.
+template <typename T>
+class Awaitable {
+public:
+  using Start = std::function<void(Awaitable&)>;
+
+  Awaitable(CoroutineExecutor& executor, Start start) : executor(executor), start(std::move(start)) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  void await_suspend(std::coroutine_handle<> handle) {
+    this->handle = handle;
+    start(*this);
+  }
+
+  T await_resume() {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return std::move(*result);
+  }
+
+  void Complete(T value) {
+    result.emplace(std::move(value));
+    executor.Post(handle);
+  }
+
+  void Fail(std::exception_ptr error_) {
+    error = error_;
+    executor.Post(handle);
+  }
+
+private:
+  CoroutineExecutor& executor;
+  Start start;
+  std::coroutine_handle<> handle;
+  std::optional<T> result;
+  std::exception_ptr error;
+};
+
+// Выполняет `job()` задачей пула `pool` и возвращает ее результат.
+template <typename T>
+Awaitable<T> AwaitInPool(CoroutineExecutor& executor, MultiplierPool& pool, std::function<T()> job) {
+  return Awaitable<T>(executor, [&pool, job = std::move(job)](Awaitable<T>& awaitable) {
+    pool.Submit([&awaitable, &job](AsyncMultiplier&) {
+      std::optional<T> value;
+      try {
+        value.emplace(job());
+      }
+      catch (...) {
+        awaitable.Fail(std::current_exception());
+        return;
+      }
+      awaitable.Complete(std::move(*value));
+    });
+  });
+}
+
+// Произведение чисел от `from` до `to`, вычисленное одним вычислителем пула.
+Awaitable<BigInteger> AwaitRangeProduct(CoroutineExecutor& executor, MultiplierPool& pool, uint64_t from,
+                                        uint64_t to);
+
+// `n!`, вычисленный `ComputeFactorialAsync()`.
+Awaitable<BigInteger> AwaitFactorial(CoroutineExecutor& executor, uint64_t n, FactorialAlgorithm algorithm,
+                                     WorkPartition partition, MultiplierPool& pool,
+                                     FactorialCache* cache = nullptr);
+
+// `n! mod modulus`, вычисленный `ComputeFactorialModAsync()`.
+Awaitable<uint64_t> AwaitFactorialMod(CoroutineExecutor& executor, uint64_t n, uint64_t modulus,
+                                      MultiplierPool& pool);
@@ -0,0 +1,431 @@
+#include "factorial.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+#include "modular.hpp"
+#include "parallel.hpp"
+#include "prime_swing.hpp"
+
+namespace {
+
+using Range = std::pair<uint64_t, uint64_t>;
+using Finish = std::function<void(std::vector<BigInteger>)>;
+
+// Передает исключение, перехваченное задачей пула, обработчику `fail`, а если
+// обработчик не задан - пробрасывает его дальше, в пул. Вызывается только из
+// блока `catch`.
+void ReportFailure(const FailureHandler& fail) {
+  if (!fail) {
+    throw;
+  }
+  fail(std::current_exception());
+}
+
+// Вычисление, разбитое на части. Части выполняются задачами пула, а задача,
+// завершившаяся последней, передает их результаты `finish`. Если часть или
+// `finish` завершились исключением, оно передается `fail` (один раз на
+// вычисление), а оставшиеся части не выполняются.
+struct Job {
+  std::vector<BigInteger> results;
+  std::atomic<size_t> remaining;
+  std::atomic<bool> failed{false};
+  Finish finish;
+  FailureHandler fail;
+
+  void Fail() {
+    if (!failed.exchange(true)) {
+      ReportFailure(fail);
+    }
+  }
+};
+
+// Запускает в пуле вычисление из `count` частей: часть `i` вычисляется
+// вызовом `run(multiplier, i)` на вычислителе потока, выполняющего задачу.
+template <typename Run>
+void RunJob(MultiplierPool& pool, size_t count, Run run, Finish finish, FailureHandler fail = nullptr) {
+  auto job = std::make_shared<Job>();
+  job->results.resize(count);
+  job->remaining = count;
+  job->finish = std::move(finish);
+  job->fail = std::move(fail);
+  if (count == 0) {
+    pool.Submit([job](AsyncMultiplier&) {
+      try {
+        job->finish({});
+      }
+      catch (...) {
+        job->Fail();
+      }
+    });
+    return;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    pool.Submit([job, run, i](AsyncMultiplier& multiplier) {
+      if (job->failed) {
+        return;
+      }
+      try {
+        job->results[i] = run(multiplier, i);
+        if (--job->remaining == 0) {
+          job->finish(std::move(job->results));
+        }
+      }
+      catch (...) {
+        job->Fail();
+      }
+    });
+  }
+}
+
+// Делит [from, to] на `count` отрезков равной длины (пустые отрезки
+// пропускаются).
+std::vector<Range> EqualRanges(uint64_t from, uint64_t to, uint64_t count) {
+  const uint64_t length = from <= to ? to - from + 1 : 0;
+  const uint64_t quotient = length / count;
+  const uint64_t remainder = length % count;
+  std::vector<Range> ranges;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (quotient == 0 && i >= remainder) {
+      break;
+    }
+    uint64_t range_to = from + quotient - 1;
+    if (i < remainder) {
+      ++range_to;
+    }
+    ranges.emplace_back(from, range_to);
+    from = range_to + 1;
+  }
+  return ranges;
+}
+
+// Делит [from, to] не более чем на `count` отрезков равной стоимости.
+// Стоимость отрезка [1, x] - длина `x!` в битах, то есть `lgamma(x + 1) / ln 2`,
+// поэтому правая граница `i`-го отрезка - наименьшее `x`, для которого
+// `lgamma(x + 1) - lgamma(from) >= (lgamma(to + 1) - lgamma(from)) * i / count`.
+// Верхние отрезки получаются короче нижних.
+std::vector<Range> BalancedRanges(uint64_t from, uint64_t to, uint64_t count) {
+  const double base = std::lgamma((double)from);
+  const double total = std::lgamma(to + 1.0) - base;
+  std::vector<Range> ranges;
+  for (uint64_t i = 1; i <= count && from <= to; ++i) {
+    uint64_t range_to = to;
+    if (i < count) {
+      const double target = base + total * i / count;
+      uint64_t low = from;
+      while (low < range_to) {
+        const uint64_t middle = low + (range_to - low) / 2;
+        if (std::lgamma(middle + 1.0) >= target) {
+          range_to = middle;
+        }
+        else {
+          low = middle + 1;
+        }
+      }
+    }
+    ranges.emplace_back(from, range_to);
+    from = range_to + 1;
+  }
+  return ranges;
+}
+
+// Вычисляет `n!` как `m! * (m + 1) * ... * n`, где `m!` - `prefix` (если
+// `prefix` пусто, `m = 0`).
+void RangeSplitFactorial(uint64_t n, uint64_t m, FactorialCache::Value prefix, WorkPartition partition,
+                         MultiplierPool& pool, std::function<void(BigInteger)> done, FailureHandler fail) {
+  const size_t threads = pool.Size();
+  auto ranges = std::make_shared<std::vector<Range>>();
+  switch (partition) {
+    case WorkPartition::Equal:
+      *ranges = EqualRanges(m + 1, n, threads);
+      break;
+    case WorkPartition::Balanced:
+      *ranges = BalancedRanges(m + 1, n, threads);
+      break;
+    case WorkPartition::Dynamic:
+      *ranges = BalancedRanges(m + 1, n, threads * kChunksPerWorker);
+      break;
+  }
+
+  // Результаты частей перемножаются сбалансированным деревом, чтобы
+  // множители последних, самых дорогих умножений были близки по размеру.
+  // Эти умножения выполняются во всех доступных потоках.
+  RunJob(
+      pool, ranges->size(),
+      [ranges](AsyncMultiplier& multiplier, size_t i) {
+        multiplier.SetTask((*ranges)[i].first, (*ranges)[i].second);
+        return std::move(*multiplier.GetResult());
+      },
+      [threads, prefix, done = std::move(done)](std::vector<BigInteger> results) {
+        if (!prefix) {
+          done(ProductTree(std::move(results), threads));
+        }
+        else if (results.empty()) {
+          done(BigInteger(*prefix));
+        }
+        else {
+          done(Multiply(*prefix, ProductTree(std::move(results), threads), threads));
+        }
+      },
+      std::move(fail));
+}
+
+// Часть произведения множителей одного уровня, вычисляемая одним
+// вычислителем.
+struct Chunk {
+  size_t level;
+  std::vector<uint64_t> factors;
+};
+
+// Делит множители каждого уровня на отрезки примерно равной суммарной длины
+// в битах (длина произведения пропорциональна ей), чтобы всего получилось
+// около `count` отрезков.
+std::vector<Chunk> SplitIntoChunks(const std::vector<std::vector<uint64_t>>& levels, size_t count) {
+  uint64_t total_bits = 0;
+  for (const auto& factors : levels) {
+    for (uint64_t factor : factors) {
+      total_bits += 64 - __builtin_clzll(factor);
+    }
+  }
+  const uint64_t chunk_bits = std::max<uint64_t>(1, (total_bits + count - 1) / count);
+  std::vector<Chunk> chunks;
+  for (size_t level = 0; level < levels.size(); ++level) {
+    uint64_t bits = 0;
+    for (uint64_t factor : levels[level]) {
+      if (bits == 0) {
+        chunks.push_back({level, {}});
+      }
+      chunks.back().factors.push_back(factor);
+      bits += 64 - __builtin_clzll(factor);
+      if (bits >= chunk_bits) {
+        bits = 0;
+      }
+    }
+  }
+  return chunks;
+}
+
+// n! = Odd(n) * 2^e, где e - показатель двойки по формуле Лежандра, а нечетная
+// часть вычисляется рекурсией Odd(m) = Odd(m/2)^2 * OddSwing(m). Раскрывая
+// рекурсию, Odd(n) = prod_i OddSwing(n / 2^i)^(2^i), поэтому множители
+// всех уровней известны заранее: они перемножаются вычислителями
+// независимо, а затем уровни собираются возведениями в квадрат от верхнего
+// уровня к нижнему.
+void PrimeSwingFactorial(uint64_t n, WorkPartition partition, MultiplierPool& pool,
+                         std::function<void(BigInteger)> done, FailureHandler fail) {
+  const size_t threads = pool.Size();
+  const std::vector<uint32_t> primes = SievePrimes(n);
+  std::vector<std::vector<uint64_t>> levels;
+  for (uint64_t m = n; m >= 3; m /= 2) {
+    levels.push_back(OddSwingFactors(m, primes));
+  }
+
+  const size_t chunk_count = partition == WorkPartition::Dynamic ? threads * kChunksPerWorker : threads;
+  auto chunks = std::make_shared<std::vector<Chunk>>(SplitIntoChunks(levels, chunk_count));
+  const size_t level_count = levels.size();
+  RunJob(
+      pool, chunks->size(),
+      [chunks](AsyncMultiplier& multiplier, size_t i) {
+        multiplier.SetFactorsTask(std::move((*chunks)[i].factors));
+        return std::move(*multiplier.GetResult());
+      },
+      [n, threads, chunks, level_count, done = std::move(done)](std::vector<BigInteger> results) {
+        std::vector<std::vector<BigInteger>> level_products(level_count);
+        for (size_t i = 0; i < results.size(); ++i) {
+          level_products[(*chunks)[i].level].push_back(std::move(results[i]));
+        }
+        BigInteger result(1);
+        for (size_t level = level_count; level-- > 0;) {
+          result = Multiply(result, result, threads);
+          result = Multiply(result, ProductTree(std::move(level_products[level]), threads), threads);
+        }
+        result <<= LegendreExponent(n, 2);
+        done(std::move(result));
+      },
+      std::move(fail));
+}
+
+}
+
+FactorialAlgorithm ParseFactorialAlgorithm(const std::string& name) {
+  if (name == "range") {
+    return FactorialAlgorithm::RangeSplit;
+  }
+  if (name == "swing") {
+    return FactorialAlgorithm::PrimeSwing;
+  }
+  throw std::runtime_error("Unknown algorithm: " + name + " (expected range or swing)");
+}
+
+WorkPartition ParseWorkPartition(const std::string& name) {
+  if (name == "equal") {
+    return WorkPartition::Equal;
+  }
+  if (name == "balanced") {
+    return WorkPartition::Balanced;
+  }
+  if (name == "dynamic") {
+    return WorkPartition::Dynamic;
+  }
+  throw std::runtime_error("Unknown partition: " + name + " (expected equal, balanced or dynamic)");
+}
+
+void ComputeFactorialAsync(uint64_t n, FactorialAlgorithm algorithm, WorkPartition partition,
+                           MultiplierPool& pool, std::function<void(BigInteger)> done,
+                           FactorialCache* cache, FailureHandler fail) {
+  if (cache != nullptr) {
+    std::optional<std::pair<uint64_t, FactorialCache::Value>> cached = cache->Find(n);
+    if (cached && cached->first == n) {
+      // `n!` есть в кэше: передаем копию задачей пула, чтобы `done`, как и
+      // при вычислении, вызывался из потока пула.
+      pool.Submit([value = std::move(cached->second), done = std::move(done),
+                   fail = std::move(fail)](AsyncMultiplier&) {
+        try {
+          done(BigInteger(*value));
+        }
+        catch (...) {
+          ReportFailure(fail);
+        }
+      });
+      return;
+    }
+    // Вычисленный факториал сохраняется в кэше перед передачей `done`.
+    done = [n, cache, done = std::move(done)](BigInteger result) {
+      auto value = std::make_shared<const BigInteger>(result);
+      cache->Insert(n, std::move(value));
+      done(std::move(result));
+    };
+    if (cached) {
+      // Если в кэше есть `m!`, `m < n`, досчитываем произведение (m, n].
+      RangeSplitFactorial(n, cached->first, std::move(cached->second), partition, pool, std::move(done),
+                          std::move(fail));
+      return;
+    }
+  }
+  switch (algorithm) {
+    case FactorialAlgorithm::RangeSplit:
+      RangeSplitFactorial(n, 0, nullptr, partition, pool, std::move(done), std::move(fail));
+      return;
+    case FactorialAlgorithm::PrimeSwing:
+      PrimeSwingFactorial(n, partition, pool, std::move(done), std::move(fail));
+      return;
+  }
+  throw std::runtime_error("Unknown algorithm");
+}
+
+void ComputeFactorialBatchAsync(std::vector<uint64_t> values, WorkPartition partition,
+                                MultiplierPool& pool,
+                                std::function<void(uint64_t, const BigInteger&)> done) {
+  const size_t threads = pool.Size();
+  std::sort(values.begin(), values.end());
+  std::vector<uint64_t> distinct = values;
+  distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+  const uint64_t max = distinct.empty() ? 0 : distinct.back();
+
+  // Делим [1, max] на части так же, как для одного факториала, и разрезаем
+  // части по границам отрезков: отрезок `i` - это (distinct[i - 1],
+  // distinct[i]].
+  const size_t chunk_count = partition == WorkPartition::Dynamic ? threads * kChunksPerWorker : threads;
+  const std::vector<Range> parts = partition == WorkPartition::Equal
+      ? EqualRanges(1, max, chunk_count) : BalancedRanges(1, max, chunk_count);
+  auto ranges = std::make_shared<std::vector<Range>>();
+  auto segments = std::make_shared<std::vector<size_t>>();
+  size_t segment = 0;
+  for (auto [from, to] : parts) {
+    while (from <= to) {
+      while (distinct[segment] < from) {
+        ++segment;
+      }
+      const uint64_t range_to = std::min(to, distinct[segment]);
+      ranges->emplace_back(from, range_to);
+      segments->push_back(segment);
+      from = range_to + 1;
+    }
+  }
+
+  RunJob(
+      pool, ranges->size(),
+      [ranges](AsyncMultiplier& multiplier, size_t i) {
+        multiplier.SetTask((*ranges)[i].first, (*ranges)[i].second);
+        return std::move(*multiplier.GetResult());
+      },
+      [threads, segments, distinct, values = std::move(values), done = std::move(done)](
+          std::vector<BigInteger> results) {
+        // Произведения отрезков вычисляются деревьями параллельно, а затем
+        // последовательно накапливаются в префиксном произведении.
+        std::vector<std::vector<BigInteger>> segment_parts(distinct.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+          segment_parts[(*segments)[i]].push_back(std::move(results[i]));
+        }
+        std::vector<BigInteger> segment_products(distinct.size());
+        const int threads_per_segment = std::max<int>(1, threads / std::max<size_t>(1, distinct.size()));
+        ParallelFor(distinct.size(), threads, [&](size_t i) {
+          segment_products[i] = ProductTree(std::move(segment_parts[i]), threads_per_segment);
+        });
+        BigInteger prefix(1);
+        size_t value_index = 0;
+        for (size_t i = 0; i < distinct.size(); ++i) {
+          prefix = Multiply(prefix, segment_products[i], threads);
+          for (; value_index < values.size() && values[value_index] == distinct[i]; ++value_index) {
+            done(distinct[i], prefix);
+          }
+        }
+      });
+}
+
+void ComputeFactorialModAsync(uint64_t n, uint64_t modulus, MultiplierPool& pool,
+                              std::function<void(uint64_t)> done, FailureHandler fail) {
+  if (modulus == 0 || modulus > kMaxModulus) {
+    throw std::runtime_error("Modulus should be in range [1, " + std::to_string(kMaxModulus) + "]");
+  }
+  // Среди множителей есть сам модуль.
+  if (n >= modulus) {
+    pool.Submit([done = std::move(done), fail = std::move(fail)](AsyncMultiplier&) {
+      try {
+        done(0);
+      }
+      catch (...) {
+        ReportFailure(fail);
+      }
+    });
+    return;
+  }
+  // Время вычисления части почти не зависит от положения отрезка, поэтому
+  // части берутся равной длины. Более мелкое разбиение только увеличило бы
+  // общую работу: для длинного отрезка она растет как корень из длины части,
+  // умноженный на количество частей.
+  auto ranges = std::make_shared<std::vector<Range>>(EqualRanges(1, n, pool.Size()));
+  RunJob(
+      pool, ranges->size(),
+      [ranges, modulus](AsyncMultiplier& multiplier, size_t i) {
+        multiplier.SetModTask((*ranges)[i].first, (*ranges)[i].second, modulus);
+        return std::move(*multiplier.GetResult());
+      },
+      [modulus, done = std::move(done)](std::vector<BigInteger> results) {
+        uint64_t result = 1 % modulus;
+        for (const BigInteger& part : results) {
+          // Остаток меньше 2^63 и занимает не больше двух цифр.
+          const std::vector<BigInteger::Limb>& limbs = part.Limbs();
+          uint64_t value = 0;
+          for (size_t i = limbs.size(); i-- > 0;) {
+            value = value << 32 | limbs[i];
+          }
+          result = MulMod(result, value, modulus);
+        }
+        done(result);
+      },
+      std::move(fail));
+}
+
+BigInteger ComputeFactorial(uint64_t n, FactorialAlgorithm algorithm, WorkPartition partition,
+                            MultiplierPool& pool) {
+  BigInteger result;
+  ComputeFactorialAsync(n, algorithm, partition, pool,
+                        [&result](BigInteger value) { result = std::move(value); });
+  pool.Wait();
+  return result;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "big_integer.hpp"
+#include "factorial_cache.hpp"
+#include "multiplier_pool.hpp"
+
+// Алгоритмы вычисления факториала.
+enum struct FactorialAlgorithm {
+  // Отрезок [1, n] делится на равные части, каждую часть перемножает свой
+  // вычислитель.
+  RangeSplit,
+  // Алгоритм Лушного через разложение на простые множители и "качающийся
+  // факториал" (prime swing).
+  PrimeSwing,
+};
+
+// Способы разбиения работы между вычислителями.
+enum struct WorkPartition {
+  // Отрезок [1, n] делится на части равной длины, по одной на вычислитель.
+  Equal,
+  // Части, по одной на вычислитель, имеют равную оценку стоимости - сумму
+  // двоичных логарифмов множителей (длину произведения в битах).
+  Balanced,
+  // Работа делится на `kChunksPerWorker` частей равной стоимости на каждый
+  // вычислитель, и вычислители забирают следующую часть, как только
+  // освобождаются. Части одного вычислителя при разбиениях `Equal` и
+  // `Balanced` тоже могут быть перехвачены другим вычислителем, если он
+  // освободится раньше.
+  Dynamic,
+};
+
+// Количество частей на вычислитель при разбиении `WorkPartition::Dynamic`.
+constexpr size_t kChunksPerWorker = 8;
+
+// Алгоритм по названию: `range` или `swing`.
+FactorialAlgorithm ParseFactorialAlgorithm(const std::string& name);
+// Разбиение по названию: `equal`, `balanced` или `dynamic`.
+WorkPartition ParseWorkPartition(const std::string& name);
+
+// Обработчик ошибки асинхронного вычисления: получает первое исключение,
+// которым завершилась какая-либо задача вычисления. После него `done` не
+// вызывается.
+using FailureHandler = std::function<void(std::exception_ptr)>;
+
+// Запускает вычисление `n!` алгоритмом `algorithm` в пуле `pool`, разбивая
+// работу способом `partition`, и возвращает управление сразу. Алгоритм
+// `swing` всегда делит множители на части равной стоимости, `Equal` для него
+// равносильно `Balanced`. Когда результат готов, в одном из потоков пула
+// вызывается `done(result)`: заключительные умножения выполняются там же с
+// использованием `pool.Size()` потоков. Несколько вычислений могут
+// выполняться одновременно. Если задан кэш `cache`, вычисление продолжается
+// от ближайшего подходящего факториала из кэша (см. `FactorialCache::Find()`),
+// а результат сохраняется в кэше. Если какая-либо задача вычисления
+// завершилась исключением, в потоке пула вызывается `fail(error)`, а если
+// `fail` не задан, исключение пробрасывается из `MultiplierPool::Wait()`.
+void ComputeFactorialAsync(uint64_t n, FactorialAlgorithm algorithm, WorkPartition partition,
+                           MultiplierPool& pool, std::function<void(BigInteger)> done,
+                           FactorialCache* cache = nullptr, FailureHandler fail = nullptr);
+
+// Вычисляет факториалы всех чисел `values` одним заданием и вызывает
+// `done(n, n!)` для каждого числа по возрастанию, в одном из потоков пула.
+// Числа сортируются, произведения отрезков между соседними различными
+// числами вычисляются вычислителями параллельно (отрезки делятся на части
+// способом `partition`), а ответы получаются проходом по отрезкам:
+// факториал предыдущего числа умножается на произведение следующего
+// отрезка. Поэтому общая работа - как у вычисления наибольшего факториала.
+// Используется алгоритм `range`, кэш не используется.
+void ComputeFactorialBatchAsync(std::vector<uint64_t> values, WorkPartition partition,
+                                MultiplierPool& pool,
+                                std::function<void(uint64_t, const BigInteger&)> done);
+
+// Запускает вычисление `n! mod modulus` (`1 <= modulus <= kMaxModulus`) в
+// пуле `pool` и возвращает управление сразу. Отрезок [1, n] делится на
+// `pool.Size()` равных частей, каждую вычислитель перемножает по модулю
+// (см. `RangeProductMod()`), а остатки перемножаются в задаче, завершившейся
+// последней, которая и вызывает `done(result)`. Если `n >= modulus`, ответ
+// равен 0 и вычислители не используются. Кэш не используется. Ошибки
+// передаются `fail` так же, как в `ComputeFactorialAsync()`.
+void ComputeFactorialModAsync(uint64_t n, uint64_t modulus, MultiplierPool& pool,
+                              std::function<void(uint64_t)> done, FailureHandler fail = nullptr);
+
+// Вычисляет `n!` в пуле `pool` и дожидается результата. Пул не должен
+// выполнять других задач.
+BigInteger ComputeFactorial(uint64_t n, FactorialAlgorithm algorithm, WorkPartition partition,
+                            MultiplierPool& pool);
@@ -0,0 +1,186 @@
+#include "factorial_cache.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint64_t kFileMagic = 0x31484341435446ull;  // "FTCACH1"
+
+// Длина `n!` в битах.
+double FactorialBits(uint64_t n) {
+  return std::lgamma(n + 1.0) / std::log(2.0);
+}
+
+// Оценка стоимости вычисления числа длины `bits`: умножение деревом
+// выполняется за O(M(bits) log bits), M(bits) ~ bits log bits.
+double RebuildCost(double bits) {
+  const double log_bits = std::log2(bits + 2);
+  return bits * log_bits * log_bits;
+}
+
+// Файл, закрываемый в деструкторе.
+struct File {
+  int fd;
+
+  File(const std::string& path, int flags) : fd(open(path.c_str(), flags, 0644)) {}
+  ~File() {
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+};
+
+}
+
+FactorialCache::FactorialCache(size_t capacity) : capacity(capacity) {}
+
+std::optional<std::pair<uint64_t, FactorialCache::Value>> FactorialCache::Find(uint64_t n) {
+  std::unique_lock lock(mutex);
+  auto it = entries.upper_bound(n);
+  if (it != entries.begin()) {
+    --it;
+    const uint64_t m = it->first;
+    if (m == n) {
+      ++stats.hits;
+      Touch(m, it->second);
+      return std::make_pair(m, it->second.value);
+    }
+    if (FactorialBits(n) - FactorialBits(m) < FactorialBits(n) / 2) {
+      ++stats.extensions;
+      Touch(m, it->second);
+      return std::make_pair(m, it->second.value);
+    }
+  }
+  ++stats.misses;
+  return std::nullopt;
+}
+
+void FactorialCache::Insert(uint64_t n, Value value) {
+  const size_t value_size = value->Limbs().size() * sizeof(BigInteger::Limb) + 1;
+  if (value_size > capacity) {
+    return;
+  }
+  std::unique_lock lock(mutex);
+  if (entries.count(n) > 0) {
+    return;
+  }
+  while (size + value_size > capacity) {
+    Evict();
+  }
+  Entry& entry = entries[n];
+  entry.value = std::move(value);
+  entry.size = value_size;
+  entry.priority = 0;
+  size += value_size;
+  Touch(n, entry);
+}
+
+FactorialCacheStats FactorialCache::Stats() {
+  std::unique_lock lock(mutex);
+  return stats;
+}
+
+void FactorialCache::Touch(uint64_t n, Entry& entry) {
+  by_priority.erase({entry.priority, n});
+  entry.priority = inflation + RebuildCost(FactorialBits(n));
+  by_priority.emplace(entry.priority, n);
+}
+
+void FactorialCache::Evict() {
+  auto [priority, n] = *by_priority.begin();
+  by_priority.erase(by_priority.begin());
+  size -= entries[n].size;
+  entries.erase(n);
+  inflation = priority;
+  ++stats.evictions;
+}
+
+void FactorialCache::Load(const std::string& path) {
+  File file(path, O_RDONLY);
+  if (file.fd == -1) {
+    if (errno == ENOENT) {
+      return;
+    }
+    throw std::runtime_error(path + ": " + strerror(errno));
+  }
+  struct stat file_stat;
+  if (fstat(file.fd, &file_stat) == -1) {
+    throw std::runtime_error(path + ": " + strerror(errno));
+  }
+  const size_t file_size = file_stat.st_size;
+  if (file_size < 2 * sizeof(uint64_t)) {
+    throw std::runtime_error(path + ": not a factorial cache");
+  }
+  void* data = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error(path + ": " + strerror(errno));
+  }
+  const uint64_t* words = (const uint64_t*)data;
+  const uint64_t* end = (const uint64_t*)((const char*)data + file_size);
+  if (words[0] != kFileMagic) {
+    munmap(data, file_size);
+    throw std::runtime_error(path + ": not a factorial cache");
+  }
+  const uint64_t count = words[1];
+  words += 2;
+  for (uint64_t i = 0; i < count; ++i) {
+    if (end - words < 2 || (uint64_t)(end - words - 2) * 2 < words[1]) {
+      munmap(data, file_size);
+      throw std::runtime_error(path + ": truncated factorial cache");
+    }
+    const uint64_t n = words[0];
+    const uint64_t limb_count = words[1];
+    const BigInteger::Limb* limbs = (const BigInteger::Limb*)(words + 2);
+    Insert(n, std::make_shared<const BigInteger>(
+                  BigInteger::FromLimbs(std::vector<BigInteger::Limb>(limbs, limbs + limb_count))));
+    // Цифры дополняются до целого числа 64-битных слов.
+    words += 2 + (limb_count + 1) / 2;
+  }
+  munmap(data, file_size);
+}
+
+void FactorialCache::Save(const std::string& path) {
+  std::unique_lock lock(mutex);
+  size_t file_size = 2 * sizeof(uint64_t);
+  for (auto& [n, entry] : entries) {
+    file_size += (2 + (entry.value->Limbs().size() + 1) / 2) * sizeof(uint64_t);
+  }
+  // Пишем во временный файл и переименовываем его, чтобы прерванное
+  // сохранение не испортило предыдущий кэш.
+  const std::string temporary_path = path + ".tmp";
+  File file(temporary_path, O_RDWR | O_CREAT | O_TRUNC);
+  if (file.fd == -1 || ftruncate(file.fd, file_size) == -1) {
+    throw std::runtime_error(temporary_path + ": " + strerror(errno));
+  }
+  void* data = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error(temporary_path + ": " + strerror(errno));
+  }
+  uint64_t* words = (uint64_t*)data;
+  words[0] = kFileMagic;
+  words[1] = entries.size();
+  words += 2;
+  for (auto& [n, entry] : entries) {
+    const std::vector<BigInteger::Limb>& limbs = entry.value->Limbs();
+    words[0] = n;
+    words[1] = limbs.size();
+    memcpy(words + 2, limbs.data(), limbs.size() * sizeof(BigInteger::Limb));
+    words += 2 + (limbs.size() + 1) / 2;
+  }
+  if (msync(data, file_size, MS_SYNC) == -1) {
+    munmap(data, file_size);
+    throw std::runtime_error(temporary_path + ": " + strerror(errno));
+  }
+  munmap(data, file_size);
+  if (rename(temporary_path.c_str(), path.c_str()) == -1) {
+    throw std::runtime_error(path + ": " + strerror(errno));
+  }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "big_integer.hpp"
+
+// Счетчики обращений к кэшу факториалов.
+struct FactorialCacheStats {
+  // `n!` найден в кэше.
+  uint64_t hits = 0;
+  // Найден `m!`, `m < n`, и `n!` досчитывается умножением на (m, n].
+  uint64_t extensions = 0;
+  // Подходящего факториала в кэше нет, `n!` вычисляется с нуля.
+  uint64_t misses = 0;
+  // Количество вытесненных из кэша факториалов.
+  uint64_t evictions = 0;
+};
+
+// Кэш вычисленных факториалов ограниченного размера. Вытеснение - по
+// алгоритму GreedyDual: приоритет факториала равен `L + cost`, где `cost` -
+// оценка стоимости повторного вычисления, а `L` - приоритет последнего
+// вытесненного факториала. Вытесняется факториал с наименьшим приоритетом,
+// при обращении приоритет обновляется. Стоимость растет быстрее размера
+// числа, поэтому дорогие в пересчете большие факториалы живут дольше
+// дешевых, а давно не использованные постепенно теряют преимущество.
+// (Деление стоимости на размер, как в GreedyDual-Size, почти уравнивает
+// приоритеты, и вытеснение вырождается в LRU.) Методы можно вызывать из
+// нескольких потоков.
+class FactorialCache {
+public:
+  using Value = std::shared_ptr<const BigInteger>;
+
+  // `capacity` - наибольший суммарный размер цифр хранимых чисел в байтах.
+  explicit FactorialCache(size_t capacity);
+
+  // Ищет факториал, от которого выгодно вычислять `n!`: сам `n!` или
+  // наибольший сохраненный `m!`, `m < n`, если произведение (m, n] короче
+  // половины `n!` в битах. Возвращает `m` и `m!` или пустой результат.
+  std::optional<std::pair<uint64_t, Value>> Find(uint64_t n);
+
+  // Сохраняет `n!`, вытесняя при необходимости другие факториалы. Числа
+  // больше всего кэша не сохраняются.
+  void Insert(uint64_t n, Value value);
+
+  FactorialCacheStats Stats();
+
+  // Загружает факториалы из файла, сохраненного `Save()`. Если файла нет,
+  // ничего не делает.
+  void Load(const std::string& path);
+  // Сохраняет снимок содержимого кэша в файл. Файл отображается в память и
+  // заполняется напрямую: заголовок `kFileMagic` и количество факториалов,
+  // затем для каждого - `n`, количество цифр и сами цифры.
+  void Save(const std::string& path);
+
+private:
+  struct Entry {
+    Value value;
+    size_t size;
+    double priority;
+  };
+
+  // Вызываются при захваченном `mutex`.
+  void Touch(uint64_t n, Entry& entry);
+  void Evict();
+
+  size_t capacity;
+  size_t size = 0;
+  // Приоритет последнего вытесненного факториала (`L`).
+  double inflation = 0;
+  std::map<uint64_t, Entry> entries;
+  // Факториалы в порядке возрастания приоритета.
+  std::set<std::pair<double, uint64_t>> by_priority;
+  FactorialCacheStats stats;
+  std::mutex mutex;
+};
@@ -0,0 +1,313 @@
+#include "limb_kernels.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <immintrin.h>
+
+namespace {
+
+using Limb = uint32_t;
+
+// Множители короче стольких цифр умножаются скалярной реализацией: на
+// коротких числах подготовка векторного умножения дороже самого умножения.
+constexpr size_t kMinVectorSize = 8;
+// То же для умножения на цифру.
+constexpr size_t kMinVectorByWordSize = 64;
+// Количество цифр короткого множителя, произведения которых накапливаются в
+// 64-битных суммах столбцов до переноса. При 1024 цифрах суммы младших
+// 52-битных половин произведений IFMA не переполняются.
+constexpr size_t kRowsPerPass = 1024;
+
+// `carry` - перенос из предыдущих цифр.
+Limb MultiplyByWordScalar(Limb* data, size_t size, Limb factor, uint64_t carry = 0) {
+  for (size_t i = 0; i < size; ++i) {
+    carry += (uint64_t)data[i] * factor;
+    data[i] = (Limb)carry;
+    carry >>= 32;
+  }
+  return carry;
+}
+
+void MultiplyBasecaseScalar(const Limb* lhs, size_t lhs_size, const Limb* rhs, size_t rhs_size,
+                            Limb* result) {
+  std::fill(result, result + lhs_size + rhs_size, 0);
+  for (size_t i = 0; i < lhs_size; ++i) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < rhs_size; ++j) {
+      carry += (uint64_t)lhs[i] * rhs[j] + result[i + j];
+      result[i + j] = (Limb)carry;
+      carry >>= 32;
+    }
+    result[i + rhs_size] = (Limb)carry;
+  }
+}
+
+// Восемь цифр, расширенные до 64 бит. Варианты с маской вместо обычных
+// используются, потому что GCC 12 ошибочно предупреждает о
+// неинициализированном значении в `_mm512_cvtepu32_epi64()`.
+__attribute__((target("avx512f")))
+inline __m512i LoadDigits8(const Limb* data) {
+  return _mm512_maskz_cvtepu32_epi64(0xff, _mm256_loadu_si256((const __m256i*)data));
+}
+
+// Векторные реализации считают произведение по столбцам: суммы
+// `low[k]` и `high[k]` младших и старших частей произведений `a[i] * b[k - i]`
+// вычисляются для нескольких соседних столбцов `k` одной инструкцией, а
+// переносы выполняются один раз для всех строк прохода. Для этого `b`
+// дополняется нулями с обеих сторон (`padded_b` указывает на `b[0]`).
+
+// Старшая половина произведения AVX2 имеет вес 2^32, то есть относится к
+// следующему столбцу.
+__attribute__((target("avx2")))
+void ColumnsAvx2(const Limb* a, size_t a_size, const Limb* padded_b, size_t b_size, uint64_t* low,
+                 uint64_t* high) {
+  const __m256i mask = _mm256_set1_epi64x(0xffffffff);
+  const size_t columns = a_size + b_size - 1;
+  for (size_t k = 0; k < columns; k += 8) {
+    __m256i low0 = _mm256_setzero_si256();
+    __m256i low1 = _mm256_setzero_si256();
+    __m256i high0 = _mm256_setzero_si256();
+    __m256i high1 = _mm256_setzero_si256();
+    const size_t first = k + 1 > b_size ? k + 1 - b_size : 0;
+    const size_t last = std::min(a_size, k + 8);
+    for (size_t i = first; i < last; ++i) {
+      const __m256i factor = _mm256_set1_epi64x(a[i]);
+      const Limb* column = padded_b + k - i;
+      const __m256i b0 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)column));
+      const __m256i b1 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(column + 4)));
+      const __m256i product0 = _mm256_mul_epu32(factor, b0);
+      const __m256i product1 = _mm256_mul_epu32(factor, b1);
+      low0 = _mm256_add_epi64(low0, _mm256_and_si256(product0, mask));
+      low1 = _mm256_add_epi64(low1, _mm256_and_si256(product1, mask));
+      high0 = _mm256_add_epi64(high0, _mm256_srli_epi64(product0, 32));
+      high1 = _mm256_add_epi64(high1, _mm256_srli_epi64(product1, 32));
+    }
+    _mm256_storeu_si256((__m256i*)(low + k), low0);
+    _mm256_storeu_si256((__m256i*)(low + k + 4), low1);
+    _mm256_storeu_si256((__m256i*)(high + k), high0);
+    _mm256_storeu_si256((__m256i*)(high + k + 4), high1);
+  }
+}
+
+// IFMA делит произведение на младшие 52 бита и старшие биты с весом 2^52 =
+// 2^32 * 2^20: они относятся к следующему столбцу со сдвигом на 20 бит.
+__attribute__((target("avx512f,avx512ifma")))
+void ColumnsAvx512Ifma(const Limb* a, size_t a_size, const Limb* padded_b, size_t b_size, uint64_t* low,
+                       uint64_t* high) {
+  const size_t columns = a_size + b_size - 1;
+  for (size_t k = 0; k < columns; k += 16) {
+    __m512i low0 = _mm512_setzero_si512();
+    __m512i low1 = _mm512_setzero_si512();
+    __m512i high0 = _mm512_setzero_si512();
+    __m512i high1 = _mm512_setzero_si512();
+    const size_t first = k + 1 > b_size ? k + 1 - b_size : 0;
+    const size_t last = std::min(a_size, k + 16);
+    for (size_t i = first; i < last; ++i) {
+      const __m512i factor = _mm512_set1_epi64(a[i]);
+      const Limb* column = padded_b + k - i;
+      const __m512i b0 = LoadDigits8(column);
+      const __m512i b1 = LoadDigits8(column + 8);
+      low0 = _mm512_madd52lo_epu64(low0, factor, b0);
+      low1 = _mm512_madd52lo_epu64(low1, factor, b1);
+      high0 = _mm512_madd52hi_epu64(high0, factor, b0);
+      high1 = _mm512_madd52hi_epu64(high1, factor, b1);
+    }
+    _mm512_storeu_si512(low + k, low0);
+    _mm512_storeu_si512(low + k + 8, low1);
+    _mm512_storeu_si512(high + k, high0);
+    _mm512_storeu_si512(high + k + 8, high1);
+  }
+}
+
+// Прибавляет к `result` (`size` цифр) столбцы `0, ..., columns`: столбец `k`
+// равен `low[k] + (high[k - 1] << high_shift)`.
+void AddColumns(const uint64_t* low, const uint64_t* high, size_t columns, int high_shift, Limb* result,
+                size_t size) {
+  uint64_t carry = 0;
+  for (size_t k = 0; k <= columns; ++k) {
+    uint64_t total = carry + result[k];
+    if (k < columns) {
+      total += low[k];
+    }
+    if (k > 0) {
+      total += high[k - 1] << high_shift;
+    }
+    result[k] = (Limb)total;
+    carry = total >> 32;
+  }
+  for (size_t k = columns + 1; carry > 0 && k < size; ++k) {
+    carry += result[k];
+    result[k] = (Limb)carry;
+    carry >>= 32;
+  }
+}
+
+// Умножение "в столбик" по столбцам с помощью `columns_kernel`, который
+// обрабатывает по `Width` столбцов.
+template <size_t Width, typename ColumnsKernel>
+void MultiplyByColumns(const Limb* lhs, size_t lhs_size, const Limb* rhs, size_t rhs_size, Limb* result,
+                       int high_shift, ColumnsKernel columns_kernel) {
+  // Строки - цифры короткого множителя: так в каждом столбце не больше
+  // `kRowsPerPass` слагаемых.
+  if (lhs_size > rhs_size) {
+    std::swap(lhs, rhs);
+    std::swap(lhs_size, rhs_size);
+  }
+  std::fill(result, result + lhs_size + rhs_size, 0);
+  thread_local std::vector<Limb> padded;
+  thread_local std::vector<uint64_t> low;
+  thread_local std::vector<uint64_t> high;
+  padded.assign(rhs_size + 2 * Width, 0);
+  std::copy(rhs, rhs + rhs_size, padded.begin() + Width);
+  for (size_t start = 0; start < lhs_size; start += kRowsPerPass) {
+    const size_t rows = std::min(kRowsPerPass, lhs_size - start);
+    const size_t columns = rows + rhs_size - 1;
+    low.resize((columns + Width - 1) / Width * Width);
+    high.resize(low.size());
+    columns_kernel(lhs + start, rows, padded.data() + Width, rhs_size, low.data(), high.data());
+    AddColumns(low.data(), high.data(), columns, high_shift, result + start, lhs_size + rhs_size - start);
+  }
+}
+
+void MultiplyBasecaseAvx2(const Limb* lhs, size_t lhs_size, const Limb* rhs, size_t rhs_size, Limb* result) {
+  if (std::min(lhs_size, rhs_size) < kMinVectorSize) {
+    MultiplyBasecaseScalar(lhs, lhs_size, rhs, rhs_size, result);
+    return;
+  }
+  MultiplyByColumns<8>(lhs, lhs_size, rhs, rhs_size, result, 0, ColumnsAvx2);
+}
+
+void MultiplyBasecaseAvx512Ifma(const Limb* lhs, size_t lhs_size, const Limb* rhs, size_t rhs_size,
+                                Limb* result) {
+  if (std::min(lhs_size, rhs_size) < kMinVectorSize) {
+    MultiplyBasecaseScalar(lhs, lhs_size, rhs, rhs_size, result);
+    return;
+  }
+  MultiplyByColumns<16>(lhs, lhs_size, rhs, rhs_size, result, 20, ColumnsAvx512Ifma);
+}
+
+// Произведения цифр на `factor` вычисляются векторно, а перенос
+// распространяется по цепочке скалярно: `carry + product < 2^64`. Цепочка
+// переносов и ограничивает скорость, поэтому выигрыш есть только на длинных
+// числах, а короткие умножаются скалярно.
+__attribute__((target("avx2")))
+Limb MultiplyByWordAvx2(Limb* data, size_t size, Limb factor) {
+  if (size < kMinVectorByWordSize) {
+    return MultiplyByWordScalar(data, size, factor);
+  }
+  const __m256i factors = _mm256_set1_epi64x(factor);
+  alignas(32) uint64_t products[8];
+  uint64_t carry = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    const __m256i digits0 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(data + i)));
+    const __m256i digits1 = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(data + i + 4)));
+    _mm256_store_si256((__m256i*)products, _mm256_mul_epu32(factors, digits0));
+    _mm256_store_si256((__m256i*)(products + 4), _mm256_mul_epu32(factors, digits1));
+    for (size_t j = 0; j < 8; ++j) {
+      carry += products[j];
+      data[i + j] = (Limb)carry;
+      carry >>= 32;
+    }
+  }
+  return MultiplyByWordScalar(data + i, size - i, factor, carry);
+}
+
+struct Kernels {
+  Limb (*multiply_by_word)(Limb* data, size_t size, Limb factor);
+  void (*multiply_basecase)(const Limb* lhs, size_t lhs_size, const Limb* rhs, size_t rhs_size,
+                            Limb* result);
+};
+
+Limb MultiplyByWordScalarEntry(Limb* data, size_t size, Limb factor) {
+  return MultiplyByWordScalar(data, size, factor);
+}
+
+Kernels KernelsOf(LimbKernel kernel) {
+  switch (kernel) {
+    case LimbKernel::Scalar:
+      return {MultiplyByWordScalarEntry, MultiplyBasecaseScalar};
+    case LimbKernel::Avx2:
+      return {MultiplyByWordAvx2, MultiplyBasecaseAvx2};
+    case LimbKernel::Avx512Ifma:
+      // Умножение на цифру ограничено цепочкой переносов, и 512-битные
+      // умножения его не ускоряют.
+      return {MultiplyByWordAvx2, MultiplyBasecaseAvx512Ifma};
+  }
+  throw std::runtime_error("Unknown limb kernel");
+}
+
+LimbKernel active_kernel = DetectLimbKernel();
+Kernels kernels = KernelsOf(active_kernel);
+
+}
+
+LimbKernel DetectLimbKernel() {
+  if (IsLimbKernelSupported(LimbKernel::Avx512Ifma)) {
+    return LimbKernel::Avx512Ifma;
+  }
+  if (IsLimbKernelSupported(LimbKernel::Avx2)) {
+    return LimbKernel::Avx2;
+  }
+  return LimbKernel::Scalar;
+}
+
+bool IsLimbKernelSupported(LimbKernel kernel) {
+  // Функция может вызываться при инициализации статических переменных, до
+  // того как среда выполнения сама опросит `cpuid`.
+  __builtin_cpu_init();
+  switch (kernel) {
+    case LimbKernel::Scalar:
+      return true;
+    case LimbKernel::Avx2:
+      return __builtin_cpu_supports("avx2");
+    case LimbKernel::Avx512Ifma:
+      return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+  }
+  return false;
+}
+
+LimbKernel GetLimbKernel() {
+  return active_kernel;
+}
+
+void SetLimbKernel(LimbKernel kernel) {
+  if (!IsLimbKernelSupported(kernel)) {
+    throw std::runtime_error(std::string("Limb kernel is not supported by the processor: ") +
+                             LimbKernelName(kernel));
+  }
+  active_kernel = kernel;
+  kernels = KernelsOf(kernel);
+}
+
+const char* LimbKernelName(LimbKernel kernel) {
+  switch (kernel) {
+    case LimbKernel::Scalar:
+      return "scalar";
+    case LimbKernel::Avx2:
+      return "avx2";
+    case LimbKernel::Avx512Ifma:
+      return "ifma";
+  }
+  return "unknown";
+}
+
+LimbKernel ParseLimbKernel(const std::string& name) {
+  for (LimbKernel kernel : {LimbKernel::Scalar, LimbKernel::Avx2, LimbKernel::Avx512Ifma}) {
+    if (name == LimbKernelName(kernel)) {
+      return kernel;
+    }
+  }
+  throw std::runtime_error("Unknown limb kernel: " + name + " (expected scalar, avx2 or ifma)");
+}
+
+uint32_t MultiplyByWord(uint32_t* data, size_t size, uint32_t factor) {
+  return kernels.multiply_by_word(data, size, factor);
+}
+
+void MultiplyBasecase(const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size,
+                      uint32_t* result) {
+  kernels.multiply_basecase(lhs, lhs_size, rhs, rhs_size, result);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Реализации внутренних циклов умножения длинных чисел.
+enum struct LimbKernel {
+  // Переносимая реализация на 64-битных умножениях.
+  Scalar,
+  // AVX2: четыре умножения 32 x 32 -> 64 бита за инструкцию.
+  Avx2,
+  // AVX-512 IFMA: восемь умножений с накоплением 52-битных половин
+  // произведения за инструкцию.
+  Avx512Ifma,
+};
+
+// Наилучшая реализация, поддерживаемая процессором (по `cpuid`). Выбирается
+// при запуске программы.
+LimbKernel DetectLimbKernel();
+bool IsLimbKernelSupported(LimbKernel kernel);
+LimbKernel GetLimbKernel();
+// Переключает реализацию. Должна вызываться до начала вычислений.
+void SetLimbKernel(LimbKernel kernel);
+
+// Название реализации (`scalar`, `avx2`, `ifma`) и реализация по названию.
+const char* LimbKernelName(LimbKernel kernel);
+LimbKernel ParseLimbKernel(const std::string& name);
+
+// Умножает число из `size` цифр `data` на цифру `factor` на месте и
+// возвращает старшую цифру произведения.
+uint32_t MultiplyByWord(uint32_t* data, size_t size, uint32_t factor);
+
+// Записывает в `result` (`lhs_size + rhs_size` цифр) произведение чисел
+// `lhs` и `rhs`, вычисленное "в столбик".
+void MultiplyBasecase(const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size,
+                      uint32_t* result);
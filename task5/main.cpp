@@ -1,88 +1,399 @@
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
 #include "async_multiplier.hpp"
+#include "big_integer.hpp"
+#include "coroutines.hpp"
+#include "factorial.hpp"
+#include "factorial_cache.hpp"
+#include "limb_kernels.hpp"
+#include "modular.hpp"
+#include "multiplication.hpp"
+#include "multiplier_pool.hpp"
+#include "radix.hpp"
+
+// Формат вывода факториалов.
+enum struct OutputFormat {
+  // `n! = <десятичная запись>`.
+  Decimal,
+  // `n! = 0x<шестнадцатеричная запись>`.
+  Hex,
+  // Двоичные записи: `n`, количество 32-битных цифр и сами цифры от младшей к
+  // старшей, все числа - в порядке байтов машины.
+  Raw,
+};
 
 struct Args {
   uint64_t processors;
   bool use_threads;
+  FactorialAlgorithm algorithm;
+  WorkPartition partition;
+  bool report_busy_time;
+  // Размер кэша факториалов в мегабайтах (0 - кэш не используется), файл,
+  // в котором кэш хранится между запусками, и вывод счетчиков кэша.
+  uint64_t cache_size;
+  std::string cache_file;
+  bool report_cache_stats;
+  // Количество запросов в пакете (0 - запросы вычисляются по одному).
+  uint64_t batch_size;
+  // Модуль, по которому вычисляются факториалы (0 - факториалы вычисляются
+  // полностью).
+  uint64_t modulus;
+  OutputFormat output;
+  ThreadHandoff handoff;
+  // Запросы обрабатываются сопрограммами в главном потоке (см.
+  // `HandleRequest()`).
+  bool use_coroutines;
 };
 
 Args ParseArgs(int argc, char** argv) {
-  Args args{std::thread::hardware_concurrency() + 1, true};
-  if (argc >= 2) {
-    if (argv[1] == std::string("--use-processes")) {
+  Args args{std::thread::hardware_concurrency() + 1, true, FactorialAlgorithm::RangeSplit,
+            WorkPartition::Dynamic, false, 0, "", false, 0, 0, OutputFormat::Decimal,
+            ThreadHandoff::Mutex, false};
+  bool processors_set = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--use-processes") {
       args.use_threads = false;
-      if (argc >= 3) {
-        throw std::runtime_error("Too many arguments");
+    }
+    else if (arg == "--algorithm") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--algorithm requires a value: range or swing");
       }
+      args.algorithm = ParseFactorialAlgorithm(argv[++i]);
     }
-    else {
+    else if (arg == "--partition") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--partition requires a value: equal, balanced or dynamic");
+      }
+      args.partition = ParseWorkPartition(argv[++i]);
+    }
+    else if (arg == "--busy-time") {
+      args.report_busy_time = true;
+    }
+    else if (arg == "--cache-size") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--cache-size requires a size in megabytes");
+      }
       try {
-        args.processors = std::stoull(argv[1]);
+        args.cache_size = std::stoull(argv[++i]);
       }
       catch (...) {
-        throw std::runtime_error("First argument should be either --use-processes or number of processors");
+        throw std::runtime_error(std::string("Invalid cache size: ") + argv[i]);
       }
-      if (argc >= 3) {
-        if (argv[2] != std::string("--use-processes")) {
-          throw std::runtime_error(std::string("Unknown argument: ") + argv[2]);
-        }
-        args.use_threads = false;
+    }
+    else if (arg == "--cache-file") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--cache-file requires a path");
+      }
+      args.cache_file = argv[++i];
+    }
+    else if (arg == "--batch") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--batch requires a number of queries");
+      }
+      try {
+        args.batch_size = std::stoull(argv[++i]);
+      }
+      catch (...) {
+        throw std::runtime_error(std::string("Invalid batch size: ") + argv[i]);
+      }
+    }
+    else if (arg == "--mod") {
+      if (i + 1 >= argc) {
+        throw std::runtime_error("--mod requires a modulus");
+      }
+      try {
+        args.modulus = std::stoull(argv[++i]);
+      }
+      catch (...) {
+        throw std::runtime_error(std::string("Invalid modulus: ") + argv[i]);
+      }
+      if (args.modulus == 0 || args.modulus > kMaxModulus) {
+        throw std::runtime_error("Modulus should be in range [1, " + std::to_string(kMaxModulus) + "]");
       }
     }
+    else if (arg == "--output") {
+      const std::string format = i + 1 < argc ? argv[++i] : "";
+      if (format == "dec") {
+        args.output = OutputFormat::Decimal;
+      }
+      else if (format == "hex") {
+        args.output = OutputFormat::Hex;
+      }
+      else if (format == "raw") {
+        args.output = OutputFormat::Raw;
+      }
+      else {
+        throw std::runtime_error("--output requires a format: dec, hex or raw");
+      }
+    }
+    else if (arg == "--cache-stats") {
+      args.report_cache_stats = true;
+    }
+    else if (arg == "--coroutines") {
+      args.use_coroutines = true;
+    }
+    else if (!processors_set) {
+      try {
+        args.processors = std::stoull(arg);
+      }
+      catch (...) {
+        throw std::runtime_error("Unknown argument: " + arg);
+      }
+      if (args.processors == 0) {
+        throw std::runtime_error("Number of processors should be positive");
+      }
+      processors_set = true;
+    }
+    else {
+      throw std::runtime_error("Unknown argument: " + arg);
+    }
+  }
+  if (args.modulus > 0 && args.batch_size > 0) {
+    throw std::runtime_error("--mod can't be combined with --batch");
+  }
+  if (args.modulus > 0 && args.output != OutputFormat::Decimal) {
+    throw std::runtime_error("--mod can't be combined with --output");
+  }
+  if (args.use_coroutines && args.batch_size > 0) {
+    throw std::runtime_error("--coroutines can't be combined with --batch");
   }
-  if (argc > 3) {
-    throw std::runtime_error("Too many arguments");
+  if (args.cache_size == 0 && (!args.cache_file.empty() || args.report_cache_stats)) {
+    throw std::runtime_error("--cache-file and --cache-stats require --cache-size");
   }
-  std::cout << "Program will use " << args.processors << " "
+  // Реализацию внутренних циклов умножения можно задать переменной среды
+  // LIMB_KERNEL (`scalar`, `avx2` или `ifma`), по умолчанию выбирается
+  // наилучшая поддерживаемая процессором. Пороги выбора алгоритма умножения
+  // по умолчанию подобраны для выбранной реализации.
+  char* kernel_var = getenv("LIMB_KERNEL");
+  if (kernel_var != NULL) {
+    const LimbKernel kernel = ParseLimbKernel(kernel_var);
+    SetLimbKernel(kernel);
+    SetMultiplicationThresholds(DefaultMultiplicationThresholds(kernel));
+  }
+  // Пороги выбора алгоритма умножения можно задать переменной среды
+  // MULTIPLICATION_THRESHOLDS в формате `karatsuba,toom3,ntt` (например,
+  // значениями, подобранными `make task5-tune`).
+  char* thresholds_var = getenv("MULTIPLICATION_THRESHOLDS");
+  if (thresholds_var != NULL) {
+    MultiplicationThresholds thresholds;
+    if (sscanf(thresholds_var, "%zu,%zu,%zu", &thresholds.karatsuba, &thresholds.toom3,
+               &thresholds.ntt) != 3) {
+      throw std::runtime_error("MULTIPLICATION_THRESHOLDS should be in format karatsuba,toom3,ntt");
+    }
+    SetMultiplicationThresholds(thresholds);
+  }
+  // Способ передачи задач вычислителям-потокам можно задать переменной среды
+  // THREAD_HANDOFF (`mutex`, `atomic` или `spin`, см. `ThreadHandoff`).
+  char* handoff_var = getenv("THREAD_HANDOFF");
+  if (handoff_var != NULL) {
+    args.handoff = ParseThreadHandoff(handoff_var);
+  }
+  // stdout содержит только результаты.
+  std::cerr << "Program will use " << args.processors << " "
       << (args.use_threads ? "threads" : "processes") << std::endl;
   return args;
 }
 
-int main(int argc, char** argv) {
-  Args args = ParseArgs(argc, argv);
+// Запись результата для вывода: строка `n! = ...` или двоичная запись (см.
+// `OutputFormat`). Десятичная запись вычисляется в `threads` потоках.
+std::string FormatResult(uint64_t value, const BigInteger& result, OutputFormat format, int threads) {
+  if (format == OutputFormat::Raw) {
+    const std::vector<BigInteger::Limb>& limbs = result.Limbs();
+    const uint64_t size = limbs.size();
+    std::string record(2 * sizeof(uint64_t) + size * sizeof(BigInteger::Limb), '\0');
+    memcpy(record.data(), &value, sizeof(uint64_t));
+    memcpy(record.data() + sizeof(uint64_t), &size, sizeof(uint64_t));
+    memcpy(record.data() + 2 * sizeof(uint64_t), limbs.data(), size * sizeof(BigInteger::Limb));
+    return record;
+  }
+  const std::string text = format == OutputFormat::Hex ? "0x" + ToHexString(result)
+                                                       : ToDecimalString(result, threads);
+  return std::to_string(value) + "! = " + text + "\n";
+}
 
-  auto multipliers = CreateMultipliers(args.processors, args.use_threads);
+// Обработка одного запроса сопрограммой: она запускает вычисление и
+// приостанавливается до его завершения, затем так же ожидает перевода
+// результата в нужную запись задачей пула. Вывод выполняется в потоке
+// исполнителя, поэтому не требует синхронизации.
+Coroutine HandleRequest(uint64_t value, const Args& args, MultiplierPool& pool, FactorialCache* cache,
+                        CoroutineExecutor& executor) {
+  std::string record;
+  if (args.modulus > 0) {
+    const uint64_t result = co_await AwaitFactorialMod(executor, value, args.modulus, pool);
+    record = std::to_string(value) + "! mod " + std::to_string(args.modulus) + " = " + std::to_string(result) + "\n";
+  }
+  else {
+    const BigInteger result = co_await AwaitFactorial(executor, value, args.algorithm, args.partition, pool, cache);
+    record = co_await AwaitInPool<std::string>(executor, pool, [&]() {
+      return FormatResult(value, result, args.output, pool.Size());
+    });
+  }
+  std::cout << record << std::flush;
+}
 
-  std::string input;
-  while (std::cin >> input) {
-    uint64_t value = std::stoll(input);
-    
-    uint64_t quotient = value / args.processors;
-    uint64_t remainder = value % args.processors;
-
-    // Распределяем задачи по вычислителям.
-    uint64_t from = 1;
-    for (uint64_t i = 0; i < args.processors; ++i) {
-      if (quotient == 0 && i >= remainder) {
+// Читает запросы из stdin и обрабатывает каждый сопрограммой
+// `HandleRequest()`. Главный поток ждет в `poll()` одновременно новых данных
+// в stdin и сопрограмм, готовых к возобновлению (`CoroutineExecutor::ReadyFd()`),
+// поэтому результат выводится сразу после вычисления, даже если следующий
+// запрос еще не введен. stdin читается блоками в обход `std::cin`: чтение не
+// должно блокироваться на середине числа.
+void RunCoroutines(const Args& args, MultiplierPool& pool, FactorialCache* cache, CoroutineExecutor& executor) {
+  std::string token;
+  auto spawn_token = [&]() {
+    if (!token.empty()) {
+      executor.Spawn(HandleRequest(std::stoll(token), args, pool, cache, executor));
+      token.clear();
+    }
+  };
+  bool input_open = true;
+  while (input_open) {
+    pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {executor.ReadyFd(), POLLIN, 0}};
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) {
         continue;
       }
-      uint64_t to = from + quotient - 1;
-      if (i < remainder) {
-        ++to;
+      throw std::runtime_error(strerror(errno));
+    }
+    if (fds[1].revents & POLLIN) {
+      executor.RunReady();
+    }
+    if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+      char buffer[4096];
+      const ssize_t size = read(STDIN_FILENO, buffer, sizeof(buffer));
+      if (size == -1) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::runtime_error(strerror(errno));
+      }
+      input_open = size > 0;
+      for (ssize_t i = 0; i < size; ++i) {
+        if (std::isspace((unsigned char)buffer[i])) {
+          spawn_token();
+        }
+        else {
+          token += buffer[i];
+        }
       }
-      multipliers[i]->SetTask(from, to);
-      from = to + 1;
     }
+  }
+  spawn_token();
+  executor.Run();
+}
+
+int main(int argc, char** argv) {
+  Args args = ParseArgs(argc, argv);
+  if (!args.use_threads) {
+    // Запись в pipe завершившегося вычислителя-процесса должна завершаться
+    // ошибкой в задаче пула, а не сигналом, завершающим программу.
+    signal(SIGPIPE, SIG_IGN);
+  }
+
+  MultiplierPool pool(CreateMultipliers(args.processors, args.use_threads, args.handoff));
+  std::unique_ptr<FactorialCache> cache;
+  if (args.cache_size > 0) {
+    cache = std::make_unique<FactorialCache>(args.cache_size << 20);
+    if (!args.cache_file.empty()) {
+      cache->Load(args.cache_file);
+    }
+  }
+
+  // Запросы не ждут друг друга: каждый запускается сразу после чтения, а
+  // его результат выводится потоком пула, как только вычислен. Поэтому
+  // результаты могут выводиться не в порядке запросов.
+  // Перевод в десятичную запись выполняется до захвата мьютекса в
+  // `pool.Size()` потоках.
+  std::mutex output_mutex;
+  auto print = [&output_mutex, &args, &pool](uint64_t value, const BigInteger& result) {
+    const std::string record = FormatResult(value, result, args.output, pool.Size());
+    std::unique_lock lock(output_mutex);
+    std::cout << record << std::flush;
+  };
+  // В пакетном режиме запросы собираются в пакеты по `batch_size`, и
+  // факториалы пакета вычисляются одним проходом по отсортированным
+  // запросам (см. `ComputeFactorialBatchAsync()`). Перевод ответов в
+  // десятичную запись выполняется отдельными задачами пула, чтобы не
+  // задерживать вычисление следующих ответов пакета.
+  std::vector<uint64_t> batch;
+  auto submit_batch = [&]() {
+    ComputeFactorialBatchAsync(std::move(batch), args.partition, pool,
+                               [&pool, &cache, &print](uint64_t value, const BigInteger& result) {
+      auto shared_result = std::make_shared<const BigInteger>(result);
+      if (cache) {
+        cache->Insert(value, shared_result);
+      }
+      pool.Submit([value, shared_result, &print](AsyncMultiplier&) { print(value, *shared_result); });
+    });
+    batch.clear();
+  };
 
-    // Ожидаем результатов вычислений.
-    uint64_t result = 1;
-    for (auto& multiplier : multipliers) {
-      uint64_t task_result = multiplier->GetResult();
-      if (task_result != 0) {
-        result*= task_result;
+  // С параметром `--coroutines` запросы читает и обрабатывает
+  // `RunCoroutines()`.
+  CoroutineExecutor executor;
+  if (args.use_coroutines) {
+    RunCoroutines(args, pool, cache.get(), executor);
+  }
+
+  std::string input;
+  while (!args.use_coroutines && std::cin >> input) {
+    uint64_t value = std::stoll(input);
+    if (args.modulus > 0) {
+      // По модулю вычисляется только остаток, кэш не используется.
+      ComputeFactorialModAsync(value, args.modulus, pool, [value, &args, &output_mutex](uint64_t result) {
+        std::unique_lock lock(output_mutex);
+        std::cout << value << "! mod " << args.modulus << " = " << result << std::endl;
+      });
+      continue;
+    }
+    if (args.batch_size > 0) {
+      batch.push_back(value);
+      if (batch.size() == args.batch_size) {
+        submit_batch();
       }
+      continue;
     }
+    ComputeFactorialAsync(value, args.algorithm, args.partition, pool,
+                          [value, &print](BigInteger result) { print(value, result); }, cache.get());
+  }
+  if (!batch.empty()) {
+    submit_batch();
+  }
+  pool.Wait();
 
-    std::cout << value << "! = " << result << std::endl;
+  if (cache && !args.cache_file.empty()) {
+    cache->Save(args.cache_file);
+  }
+  if (cache && args.report_cache_stats) {
+    FactorialCacheStats stats = cache->Stats();
+    std::cerr << "Cache: " << stats.hits << " hits, " << stats.extensions << " extensions, "
+              << stats.misses << " misses, " << stats.evictions << " evictions" << std::endl;
   }
 
-  for (auto& multiplier : multipliers) {
-    multiplier->Finish();
+  if (args.report_busy_time) {
+    // Процессорное время каждого вычислителя за все запросы: при хорошем
+    // разбиении работы вычислители заняты примерно одинаково.
+    std::cerr << "Busy time, ms:";
+    for (std::chrono::nanoseconds busy : pool.BusyTimes()) {
+      std::cerr << " " << std::fixed << std::setprecision(1)
+                << std::chrono::duration<double, std::milli>(busy).count();
+    }
+    std::cerr << std::endl;
   }
-  
+
   return 0;
 }
@@ -0,0 +1,464 @@
+#include "modular.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "multiplication.hpp"
+
+namespace {
+
+// Многочлен по модулю: коэффициенты от младшего к старшему.
+using Poly = std::vector<uint64_t>;
+
+// Многочлены, меньший из которых короче, перемножаются "в столбик".
+constexpr size_t kSchoolbookSize = 32;
+// Количество точек в листе дерева подпроизведений: значения многочлена в
+// них вычисляются по схеме Горнера.
+constexpr size_t kLeafPoints = 16;
+
+int BitLength(uint64_t value) {
+  return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+uint64_t AddMod(uint64_t a, uint64_t b, uint64_t modulus) {
+  const uint64_t sum = a + b;
+  return sum >= modulus ? sum - modulus : sum;
+}
+
+uint64_t SubMod(uint64_t a, uint64_t b, uint64_t modulus) {
+  return a >= b ? a - b : a + modulus - b;
+}
+
+// Записывает `value` в массив цифр, начиная с бита `position`. Биты массива
+// на этом месте должны быть нулевыми.
+void PutBits(std::vector<uint32_t>& limbs, size_t position, uint64_t value) {
+  const size_t index = position / 32;
+  const unsigned __int128 shifted = (unsigned __int128)value << (position % 32);
+  limbs[index] |= (uint32_t)shifted;
+  limbs[index + 1] |= (uint32_t)(shifted >> 32);
+  limbs[index + 2] |= (uint32_t)(shifted >> 64);
+}
+
+// Читает `count <= 64` битов массива цифр, начиная с бита `position`.
+uint64_t GetBits(const std::vector<uint32_t>& limbs, size_t position, int count) {
+  const size_t index = position / 32;
+  unsigned __int128 window = 0;
+  for (size_t i = 0; i < 4 && index + i < limbs.size(); ++i) {
+    window |= (unsigned __int128)limbs[index + i] << (32 * i);
+  }
+  const uint64_t bits = (uint64_t)(window >> (position % 32));
+  return count < 64 ? bits & ((1ull << count) - 1) : bits;
+}
+
+// Остаток от деления на `modulus` числа из `bits` битов массива цифр,
+// начиная с бита `position`.
+uint64_t ReadSlot(const std::vector<uint32_t>& limbs, size_t position, int bits, uint64_t modulus) {
+  unsigned __int128 remainder = 0;
+  for (int piece = (bits - 1) / 64; piece >= 0; --piece) {
+    const int count = std::min(64, bits - piece * 64);
+    remainder = ((remainder << count) | GetBits(limbs, position + piece * 64, count)) % modulus;
+  }
+  return remainder;
+}
+
+// Произведение многочленов. Большие многочлены перемножаются подстановкой
+// Кронекера: коэффициенты записываются в длинные числа с шагом `slot` битов,
+// достаточным, чтобы коэффициенты произведения не перекрывались, числа
+// перемножаются, и коэффициенты произведения читаются с тем же шагом.
+Poly Multiply(const Poly& lhs, const Poly& rhs, uint64_t modulus) {
+  if (lhs.empty() || rhs.empty()) {
+    return {};
+  }
+  Poly result(lhs.size() + rhs.size() - 1, 0);
+  const size_t min_size = std::min(lhs.size(), rhs.size());
+  if (min_size < kSchoolbookSize) {
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      for (size_t j = 0; j < rhs.size(); ++j) {
+        result[i + j] = AddMod(result[i + j], MulMod(lhs[i], rhs[j], modulus), modulus);
+      }
+    }
+    return result;
+  }
+  const int slot = 2 * BitLength(modulus) + BitLength(min_size);
+  auto pack = [slot](const Poly& poly) {
+    std::vector<uint32_t> limbs(poly.size() * slot / 32 + 4, 0);
+    for (size_t i = 0; i < poly.size(); ++i) {
+      PutBits(limbs, i * slot, poly[i]);
+    }
+    while (!limbs.empty() && limbs.back() == 0) {
+      limbs.pop_back();
+    }
+    return limbs;
+  };
+  const std::vector<uint32_t> lhs_limbs = pack(lhs);
+  const std::vector<uint32_t> rhs_limbs = pack(rhs);
+  if (lhs_limbs.empty() || rhs_limbs.empty()) {
+    return result;
+  }
+  const std::vector<uint32_t> product = MultiplyLimbs(lhs_limbs, rhs_limbs);
+  for (size_t i = 0; i < result.size(); ++i) {
+    result[i] = ReadSlot(product, i * slot, slot, modulus);
+  }
+  return result;
+}
+
+Poly Truncated(const Poly& poly, size_t size) {
+  return Poly(poly.begin(), poly.begin() + std::min(size, poly.size()));
+}
+
+// Обратный к `poly` степенной ряд по модулю x^size (метод Ньютона:
+// b <- b (2 - a b)). Свободный член `poly` должен быть равен 1.
+Poly Inverse(const Poly& poly, size_t size, uint64_t modulus) {
+  Poly inverse = {1};
+  for (size_t length = 1; length < size;) {
+    length = std::min(2 * length, size);
+    Poly error = Multiply(Truncated(poly, length), inverse, modulus);
+    error.resize(length, 0);
+    for (uint64_t& coefficient : error) {
+      coefficient = SubMod(0, coefficient, modulus);
+    }
+    error[0] = AddMod(error[0], 2 % modulus, modulus);
+    inverse = Multiply(inverse, error, modulus);
+    inverse.resize(length, 0);
+  }
+  return inverse;
+}
+
+// Остаток от деления `dividend` на унитарный многочлен `divisor`. Частное
+// вычисляется через обратный ряд к развернутому делителю.
+Poly Remainder(const Poly& dividend, const Poly& divisor, uint64_t modulus) {
+  if (dividend.size() < divisor.size()) {
+    return dividend;
+  }
+  const size_t quotient_size = dividend.size() - divisor.size() + 1;
+  Poly reversed_dividend(dividend.rbegin(), dividend.rbegin() + quotient_size);
+  Poly reversed_divisor(divisor.rbegin(), divisor.rend());
+  Poly quotient = Multiply(reversed_dividend, Inverse(reversed_divisor, quotient_size, modulus), modulus);
+  quotient.resize(quotient_size);
+  std::reverse(quotient.begin(), quotient.end());
+  const Poly product = Multiply(divisor, quotient, modulus);
+  Poly remainder(divisor.size() - 1);
+  for (size_t i = 0; i < remainder.size(); ++i) {
+    remainder[i] = SubMod(dividend[i], product[i], modulus);
+  }
+  return remainder;
+}
+
+// Произведение (x - points[i]) для i из [from, to).
+Poly RootsProduct(const std::vector<uint64_t>& points, size_t from, size_t to, uint64_t modulus) {
+  if (to - from <= kLeafPoints) {
+    Poly result = {1};
+    for (size_t i = from; i < to; ++i) {
+      // Умножение на (x - point).
+      const uint64_t negative_point = SubMod(0, points[i], modulus);
+      result.push_back(0);
+      for (size_t j = result.size() - 1; j > 0; --j) {
+        result[j] = AddMod(result[j - 1], MulMod(result[j], negative_point, modulus), modulus);
+      }
+      result[0] = MulMod(result[0], negative_point, modulus);
+    }
+    return result;
+  }
+  const size_t middle = from + (to - from) / 2;
+  return Multiply(RootsProduct(points, from, middle, modulus), RootsProduct(points, middle, to, modulus),
+                  modulus);
+}
+
+// Дерево подпроизведений для точек [from, to): вершина `node` хранит
+// произведение (x - points[i]) по своему отрезку точек, ее дети - вершины
+// `2 node` и `2 node + 1`.
+void BuildTree(std::vector<Poly>& tree, size_t node, const std::vector<uint64_t>& points, size_t from,
+               size_t to, uint64_t modulus) {
+  if (to - from <= kLeafPoints) {
+    tree[node] = RootsProduct(points, from, to, modulus);
+    return;
+  }
+  const size_t middle = from + (to - from) / 2;
+  BuildTree(tree, 2 * node, points, from, middle, modulus);
+  BuildTree(tree, 2 * node + 1, points, middle, to, modulus);
+  tree[node] = Multiply(tree[2 * node], tree[2 * node + 1], modulus);
+}
+
+// Значения `poly` в точках [from, to): остаток от деления на произведение
+// (x - points[i]) спускается по дереву до листьев.
+void Evaluate(const Poly& poly, std::vector<Poly>& tree, size_t node, const std::vector<uint64_t>& points,
+              size_t from, size_t to, uint64_t modulus, std::vector<uint64_t>& values) {
+  const Poly remainder = Remainder(poly, tree[node], modulus);
+  tree[node].clear();
+  if (to - from <= kLeafPoints) {
+    for (size_t i = from; i < to; ++i) {
+      uint64_t value = 0;
+      for (size_t j = remainder.size(); j-- > 0;) {
+        value = AddMod(MulMod(value, points[i], modulus), remainder[j], modulus);
+      }
+      values[i] = value;
+    }
+    return;
+  }
+  const size_t middle = from + (to - from) / 2;
+  Evaluate(remainder, tree, 2 * node, points, from, middle, modulus, values);
+  Evaluate(remainder, tree, 2 * node + 1, points, middle, to, modulus, values);
+}
+
+// Последовательное произведение отрезка. Для нечетного модуля числа
+// умножаются в форме Монтгомери без перевода в нее: каждое умножение
+// добавляет множитель R^(-1), который компенсируется в конце умножением на
+// R^L. Четыре независимых произведения скрывают задержку умножения.
+uint64_t LinearRangeProductMod(uint64_t from, uint64_t to, uint64_t modulus) {
+  if (modulus % 2 == 0) {
+    uint64_t result = 1 % modulus;
+    for (uint64_t k = from; k <= to; ++k) {
+      result = MulMod(result, k, modulus);
+    }
+    return result;
+  }
+  const Montgomery montgomery(modulus);
+  uint64_t products[4] = {1, 1, 1, 1};
+  uint64_t k = from;
+  for (; k + 3 <= to; k += 4) {
+    for (int i = 0; i < 4; ++i) {
+      products[i] = montgomery.Multiply(products[i], k + i);
+    }
+  }
+  for (; k <= to; ++k) {
+    products[0] = montgomery.Multiply(products[0], k);
+  }
+  uint64_t result = 1 % modulus;
+  for (uint64_t product : products) {
+    result = MulMod(result, product, modulus);
+  }
+  return MulMod(result, PowMod(montgomery.R(), to - from + 1, modulus), modulus);
+}
+
+// Обратный к `value` по модулю `modulus` (расширенный алгоритм Евклида) или
+// 0, если обратного нет.
+uint64_t InverseMod(uint64_t value, uint64_t modulus) {
+  __int128 a = value % modulus;
+  __int128 b = modulus;
+  __int128 x = 1;
+  __int128 y = 0;
+  while (b != 0) {
+    const __int128 quotient = a / b;
+    a -= quotient * b;
+    std::swap(a, b);
+    x -= quotient * y;
+    std::swap(x, y);
+  }
+  if (a != 1 || modulus == 1) {
+    return 0;
+  }
+  return x < 0 ? x + modulus : x;
+}
+
+// Заменяет числа `values` обратными к ним: перемножаются все числа, и
+// обращается только их произведение. Возвращает false, если какое-то число
+// необратимо.
+bool InvertAll(std::vector<uint64_t>& values, uint64_t modulus) {
+  std::vector<uint64_t> prefix(values.size() + 1, 1 % modulus);
+  for (size_t i = 0; i < values.size(); ++i) {
+    prefix[i + 1] = MulMod(prefix[i], values[i], modulus);
+  }
+  uint64_t inverse = InverseMod(prefix.back(), modulus);
+  if (inverse == 0) {
+    return false;
+  }
+  for (size_t i = values.size(); i-- > 0;) {
+    const uint64_t value = values[i];
+    values[i] = MulMod(inverse, prefix[i], modulus);
+    inverse = MulMod(inverse, value, modulus);
+  }
+  return true;
+}
+
+// По значениям многочлена степени d = `values.size() - 1` в точках 0, 1, ...,
+// d вычисляет его значения в точках a, a + 1, ..., a + d. Интерполяция
+// Лагранжа сводится к свертке:
+//   h(a + k) = prod_{t=k}^{k+d} (a - d + t) * sum_i f_i / (a + k - i),
+//   f_i = h(i) / (i! (d - i)! (-1)^(d - i)).
+// `inverse_factorials` - обратные к 0!, ..., d!. Возвращает false, если
+// какое-то из чисел a - d, ..., a + d необратимо.
+bool ShiftSamples(const std::vector<uint64_t>& values, uint64_t a, const std::vector<uint64_t>& inverse_factorials,
+                  uint64_t modulus, std::vector<uint64_t>& shifted) {
+  const size_t d = values.size() - 1;
+  std::vector<uint64_t> weighted(d + 1);
+  for (size_t i = 0; i <= d; ++i) {
+    weighted[i] = MulMod(MulMod(values[i], inverse_factorials[i], modulus), inverse_factorials[d - i], modulus);
+    if ((d - i) % 2 == 1) {
+      weighted[i] = SubMod(0, weighted[i], modulus);
+    }
+  }
+  // Числа a - d + t для t = 0, ..., 2d и обратные к ним.
+  const uint64_t base = SubMod(a % modulus, d % modulus, modulus);
+  std::vector<uint64_t> points(2 * d + 1);
+  for (size_t t = 0; t <= 2 * d; ++t) {
+    points[t] = AddMod(base, t % modulus, modulus);
+  }
+  std::vector<uint64_t> inverses = points;
+  if (!InvertAll(inverses, modulus)) {
+    return false;
+  }
+  const Poly convolution = Multiply(weighted, inverses, modulus);
+  uint64_t product = 1 % modulus;
+  for (size_t t = 0; t <= d; ++t) {
+    product = MulMod(product, points[t], modulus);
+  }
+  shifted.resize(d + 1);
+  for (size_t k = 0; k <= d; ++k) {
+    shifted[k] = MulMod(product, convolution[k + d], modulus);
+    if (k < d) {
+      product = MulMod(MulMod(product, points[k + d + 1], modulus), inverses[k], modulus);
+    }
+  }
+  return true;
+}
+
+// Значения g(i) = (v i + c + 1)(v i + c + 2)...(v i + c + v), i = 0, ...,
+// v - 1, где v = `block`, c = `offset`. Значения g_d(i) = prod_{j=1}^{d}
+// (v i + c + j) в точках 0, ..., d строятся по двоичной записи v: при
+// удвоении g_2d(i) = g_d(i) g_d(i + d / v), и недостающие значения g_d
+// получаются сдвигом известных (`ShiftSamples()`), при увеличении на 1
+// значения умножаются на (v i + c + d + 1). Общая сложность - O(M(v)), где
+// M(v) - стоимость умножения многочленов степени v. Возвращает false, если
+// нужные для интерполяции числа необратимы по модулю `modulus`.
+bool BlockProductsByShifting(uint64_t block, uint64_t offset, uint64_t modulus, std::vector<uint64_t>& values) {
+  const uint64_t block_inverse = InverseMod(block, modulus);
+  std::vector<uint64_t> inverse_factorials(block + 1);
+  inverse_factorials[0] = 1 % modulus;
+  for (uint64_t i = 1; i <= block; ++i) {
+    inverse_factorials[i] = MulMod(inverse_factorials[i - 1], i, modulus);
+  }
+  const uint64_t factorial_inverse = InverseMod(inverse_factorials[block], modulus);
+  if (block_inverse == 0 || factorial_inverse == 0) {
+    return false;
+  }
+  inverse_factorials[block] = factorial_inverse;
+  for (uint64_t i = block; i > 1; --i) {
+    inverse_factorials[i - 1] = MulMod(inverse_factorials[i], i, modulus);
+  }
+
+  const uint64_t v = block % modulus;
+  const uint64_t c = offset % modulus;
+  // Линейный множитель v i + c + j.
+  auto factor = [&](uint64_t i, uint64_t j) {
+    return AddMod(AddMod(MulMod(v, i % modulus, modulus), c, modulus), j % modulus, modulus);
+  };
+  uint64_t d = 1;
+  values = {factor(0, 1), factor(1, 1)};
+  std::vector<uint64_t> next;
+  std::vector<uint64_t> shifted;
+  for (int bit = BitLength(block) - 2; bit >= 0; --bit) {
+    std::vector<uint64_t> factors(inverse_factorials.begin(), inverse_factorials.begin() + d + 1);
+    // g_d в точках d + 1, ..., 2d + 1.
+    if (!ShiftSamples(values, d + 1, factors, modulus, shifted)) {
+      return false;
+    }
+    next = values;
+    next.insert(next.end(), shifted.begin(), shifted.end());
+    // g_d в точках d / v, ..., d / v + 2d + 1.
+    const uint64_t start = MulMod(d % modulus, block_inverse, modulus);
+    std::vector<uint64_t> second_half;
+    if (!ShiftSamples(values, start, factors, modulus, shifted) ||
+        !ShiftSamples(values, AddMod(start, (d + 1) % modulus, modulus), factors, modulus, second_half)) {
+      return false;
+    }
+    shifted.insert(shifted.end(), second_half.begin(), second_half.end());
+    d *= 2;
+    next.resize(d + 1);
+    for (uint64_t i = 0; i <= d; ++i) {
+      next[i] = MulMod(next[i], shifted[i], modulus);
+    }
+    values.swap(next);
+    if ((block >> bit) & 1) {
+      for (uint64_t i = 0; i <= d; ++i) {
+        values[i] = MulMod(values[i], factor(i, d + 1), modulus);
+      }
+      uint64_t last = 1 % modulus;
+      for (uint64_t j = 1; j <= d + 1; ++j) {
+        last = MulMod(last, factor(d + 1, j), modulus);
+      }
+      values.push_back(last);
+      ++d;
+    }
+  }
+  values.resize(block);
+  return true;
+}
+
+// Те же значения g(i), вычисленные деревом подпроизведений: строится сам
+// многочлен g и его остатки от деления на произведения (x - v i) спускаются
+// по дереву. Сложность - O(M(v) log v), подходит для любого модуля.
+void BlockProductsByTree(uint64_t block, uint64_t offset, uint64_t modulus, std::vector<uint64_t>& values) {
+  std::vector<uint64_t> roots(block);
+  for (uint64_t j = 0; j < block; ++j) {
+    roots[j] = SubMod(0, (offset + 1 + j) % modulus, modulus);
+  }
+  const Poly poly = RootsProduct(roots, 0, block, modulus);
+  std::vector<uint64_t> points(block);
+  for (uint64_t i = 0; i < block; ++i) {
+    points[i] = MulMod(i, block, modulus);
+  }
+  std::vector<Poly> tree(4 * (block / kLeafPoints + 1));
+  BuildTree(tree, 1, points, 0, block, modulus);
+  values.resize(block);
+  Evaluate(poly, tree, 1, points, 0, block, modulus, values);
+}
+
+}
+
+uint64_t PowMod(uint64_t base, uint64_t exponent, uint64_t modulus) {
+  uint64_t result = 1 % modulus;
+  base %= modulus;
+  while (exponent > 0) {
+    if (exponent & 1) {
+      result = MulMod(result, base, modulus);
+    }
+    base = MulMod(base, base, modulus);
+    exponent >>= 1;
+  }
+  return result;
+}
+
+Montgomery::Montgomery(uint64_t modulus) : modulus(modulus) {
+  // Обратный к нечетному `modulus` по модулю 2^64 методом Ньютона: каждая
+  // итерация удваивает количество верных битов, начальное приближение
+  // верно в трех младших битах.
+  uint64_t inverse = modulus;
+  for (int i = 0; i < 5; ++i) {
+    inverse *= 2 - modulus * inverse;
+  }
+  negative_inverse = -inverse;
+  r = ((unsigned __int128)1 << 64) % modulus;
+}
+
+uint64_t RangeProductMod(uint64_t from, uint64_t to, uint64_t modulus) {
+  if (modulus == 0 || modulus > kMaxModulus || to >= modulus) {
+    throw std::runtime_error("Invalid modulus for range product");
+  }
+  if (from > to) {
+    return 1 % modulus;
+  }
+  const uint64_t length = to - from + 1;
+  if (length < kSqrtRangeThreshold) {
+    return LinearRangeProductMod(from, to, modulus);
+  }
+  uint64_t block = std::sqrt((double)length);
+  while (block * block > length) {
+    --block;
+  }
+  while ((block + 1) * (block + 1) <= length) {
+    ++block;
+  }
+  // g(i) - произведение чисел [from + i block, from + (i + 1) block).
+  std::vector<uint64_t> values;
+  if (!BlockProductsByShifting(block, from - 1, modulus, values)) {
+    BlockProductsByTree(block, from - 1, modulus, values);
+  }
+
+  uint64_t result = LinearRangeProductMod(from + block * block, to, modulus);
+  for (uint64_t value : values) {
+    result = MulMod(result, value, modulus);
+  }
+  return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+// Произведение `a * b` по модулю `modulus`.
+inline uint64_t MulMod(uint64_t a, uint64_t b, uint64_t modulus) {
+  return (unsigned __int128)a * b % modulus;
+}
+
+// `base^exponent` по модулю `modulus`.
+uint64_t PowMod(uint64_t base, uint64_t exponent, uint64_t modulus);
+
+// Умножение по нечетному модулю `m < 2^63` в форме Монтгомери с R = 2^64:
+// `Multiply(a, b) = a * b * R^(-1) mod m` вычисляется без деления.
+class Montgomery {
+public:
+  explicit Montgomery(uint64_t modulus);
+
+  uint64_t Multiply(uint64_t a, uint64_t b) const {
+    return Reduce((unsigned __int128)a * b);
+  }
+  // `R mod m`.
+  uint64_t R() const { return r; }
+
+private:
+  // `t * R^(-1) mod m` для `t < m * R`.
+  uint64_t Reduce(unsigned __int128 t) const {
+    const uint64_t u = (uint64_t)t * negative_inverse;
+    const uint64_t result = (t + (unsigned __int128)u * modulus) >> 64;
+    return result >= modulus ? result - modulus : result;
+  }
+
+  uint64_t modulus;
+  // `-m^(-1) mod R`.
+  uint64_t negative_inverse;
+  uint64_t r;
+};
+
+// Наибольший модуль, поддерживаемый `RangeProductMod()`.
+constexpr uint64_t kMaxModulus = (1ull << 63) - 1;
+
+// Длина отрезка, начиная с которой `RangeProductMod()` использует алгоритм
+// сложности O(sqrt(L) log L) вместо последовательного умножения.
+constexpr uint64_t kSqrtRangeThreshold = 1ull << 25;
+
+// Произведение чисел от `from` до `to` по модулю `modulus` (`1 <= modulus <=
+// kMaxModulus`, `to < modulus`). Короткие отрезки перемножаются
+// последовательно в форме Монтгомери. Для длинного отрезка [a, a + L)
+// рассматривается многочлен g(i) = (v i + a)(v i + a + 1)...(v i + a + v - 1),
+// v = floor(sqrt(L)), и вычисляются его значения в точках 0, 1, ..., v - 1 -
+// произведения блоков по v чисел. Значения строятся сдвигом отсчетов
+// (интерполяция Лагранжа), а если нужные для нее числа необратимы по модулю -
+// с помощью дерева подпроизведений. Многочлены перемножаются через длинные
+// числа (подстановка Кронекера).
+uint64_t RangeProductMod(uint64_t from, uint64_t to, uint64_t modulus);
@@ -0,0 +1,508 @@
+#include "multiplication.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#include "limb_kernels.hpp"
+#include "parallel.hpp"
+
+namespace {
+
+using Limb = uint32_t;
+using Limbs = std::vector<Limb>;
+
+MultiplicationThresholds thresholds = DefaultMultiplicationThresholds(DetectLimbKernel());
+
+// Часть массива цифр без старших нулевых цифр.
+struct View {
+  const Limb* data;
+  size_t size;
+
+  View(const Limb* data, size_t size) : data(data), size(size) {
+    while (this->size > 0 && data[this->size - 1] == 0) {
+      --this->size;
+    }
+  }
+  View(const Limbs& limbs) : View(limbs.data(), limbs.size()) {}
+
+  // Цифры с `from` по `from + count - 1` (или меньше, если число короче).
+  View Slice(size_t from, size_t count) const {
+    from = std::min(from, size);
+    return View(data + from, std::min(count, size - from));
+  }
+};
+
+void MultiplyInto(View lhs, View rhs, Limb* result, int threads);
+
+// Произведение во временном массиве из `lhs.size + rhs.size` цифр.
+Limbs Multiply(View lhs, View rhs, int threads) {
+  Limbs result(lhs.size + rhs.size);
+  MultiplyInto(lhs, rhs, result.data(), threads);
+  return result;
+}
+
+// Прибавляет к числу `result` из `size` цифр число `value`, сдвинутое на
+// `shift` цифр. Сумма должна помещаться в `size` цифр.
+void AddShifted(Limb* result, size_t size, View value, size_t shift) {
+  if (value.size == 0) {
+    return;
+  }
+  if (shift + value.size > size) {
+    throw std::runtime_error("Sum does not fit into the result");
+  }
+  uint64_t carry = 0;
+  size_t i = 0;
+  for (; i < value.size; ++i) {
+    carry += (uint64_t)result[shift + i] + value.data[i];
+    result[shift + i] = (Limb)carry;
+    carry >>= 32;
+  }
+  for (size_t j = shift + i; carry > 0; ++j) {
+    if (j == size) {
+      throw std::runtime_error("Sum does not fit into the result");
+    }
+    carry += result[j];
+    result[j] = (Limb)carry;
+    carry >>= 32;
+  }
+}
+
+// Прибавляет к `result` число `value`, сдвинутое на `shift` цифр.
+void AddShifted(Limbs& result, View value, size_t shift) {
+  if (result.size() < shift + value.size) {
+    result.resize(shift + value.size, 0);
+  }
+  uint64_t carry = 0;
+  size_t i = 0;
+  for (; i < value.size; ++i) {
+    carry += (uint64_t)result[shift + i] + value.data[i];
+    result[shift + i] = (Limb)carry;
+    carry >>= 32;
+  }
+  for (size_t j = shift + i; carry > 0; ++j) {
+    if (j == result.size()) {
+      result.push_back(0);
+    }
+    carry += result[j];
+    result[j] = (Limb)carry;
+    carry >>= 32;
+  }
+}
+
+Limbs Add(View lhs, View rhs) {
+  Limbs result(lhs.data, lhs.data + lhs.size);
+  AddShifted(result, rhs, 0);
+  return result;
+}
+
+// Вычитает `value` из `result`. Требует `result >= value`.
+void SubtractInPlace(Limbs& result, View value) {
+  int64_t borrow = 0;
+  size_t i = 0;
+  for (; i < value.size; ++i) {
+    int64_t difference = (int64_t)result[i] - value.data[i] - borrow;
+    borrow = difference < 0;
+    result[i] = (Limb)difference;
+  }
+  for (; borrow != 0; ++i) {
+    if (i == result.size()) {
+      throw std::runtime_error("Negative result of subtraction");
+    }
+    borrow = result[i] == 0;
+    --result[i];
+  }
+}
+
+int Compare(View lhs, View rhs) {
+  if (lhs.size != rhs.size) {
+    return lhs.size < rhs.size ? -1 : 1;
+  }
+  for (size_t i = lhs.size; i-- > 0;) {
+    if (lhs.data[i] != rhs.data[i]) {
+      return lhs.data[i] < rhs.data[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+// Алгоритмы ниже записывают произведение в `result` - ровно
+// `lhs.size + rhs.size` цифр.
+
+void MultiplySchoolbook(View lhs, View rhs, Limb* result) {
+  MultiplyBasecase(lhs.data, lhs.size, rhs.data, rhs.size, result);
+}
+
+// Умножение сильно различающихся по длине чисел: длинное число режется на
+// части длины короткого, и части умножаются на короткое число по отдельности.
+void MultiplyUnbalanced(View lhs, View rhs, Limb* result, int threads) {
+  const size_t size = lhs.size + rhs.size;
+  std::fill(result, result + size, 0);
+  for (size_t offset = 0; offset < lhs.size; offset += rhs.size) {
+    AddShifted(result, size, Multiply(lhs.Slice(offset, rhs.size), rhs, threads), offset);
+  }
+}
+
+// Алгоритм Карацубы: при `x = x1 * B^k + x0` и `y = y1 * B^k + y0`
+// `x * y = z2 * B^2k + (z1 - z2 - z0) * B^k + z0`, где `z0 = x0 * y0`,
+// `z2 = x1 * y1`, `z1 = (x0 + x1) * (y0 + y1)`.
+void MultiplyKaratsuba(View lhs, View rhs, Limb* result, int threads) {
+  const size_t k = (std::max(lhs.size, rhs.size) + 1) / 2;
+  View lhs0 = lhs.Slice(0, k), lhs1 = lhs.Slice(k, lhs.size);
+  View rhs0 = rhs.Slice(0, k), rhs1 = rhs.Slice(k, rhs.size);
+  Limbs z0 = Multiply(lhs0, rhs0, threads);
+  Limbs z2 = Multiply(lhs1, rhs1, threads);
+  Limbs z1 = Multiply(Add(lhs0, lhs1), Add(rhs0, rhs1), threads);
+  SubtractInPlace(z1, z0);
+  SubtractInPlace(z1, z2);
+  const size_t size = lhs.size + rhs.size;
+  std::fill(result, result + size, 0);
+  AddShifted(result, size, z0, 0);
+  AddShifted(result, size, z1, k);
+  AddShifted(result, size, z2, 2 * k);
+}
+
+// Число со знаком для промежуточных значений алгоритма Тоома-Кука.
+struct Signed {
+  Limbs magnitude;
+  bool negative = false;
+
+  Signed() = default;
+  Signed(View value) : magnitude(value.data, value.data + value.size) {}
+};
+
+Signed AddSigned(const Signed& lhs, const Signed& rhs) {
+  Signed result;
+  if (lhs.negative == rhs.negative) {
+    result.magnitude = Add(lhs.magnitude, rhs.magnitude);
+    result.negative = lhs.negative;
+  }
+  else if (Compare(lhs.magnitude, rhs.magnitude) >= 0) {
+    result.magnitude = lhs.magnitude;
+    SubtractInPlace(result.magnitude, rhs.magnitude);
+    result.negative = lhs.negative;
+  }
+  else {
+    result.magnitude = rhs.magnitude;
+    SubtractInPlace(result.magnitude, lhs.magnitude);
+    result.negative = rhs.negative;
+  }
+  if (View(result.magnitude).size == 0) {
+    result.negative = false;
+  }
+  return result;
+}
+
+Signed SubtractSigned(const Signed& lhs, const Signed& rhs) {
+  Signed negated = rhs;
+  negated.negative = !rhs.negative && View(rhs.magnitude).size > 0;
+  return AddSigned(lhs, negated);
+}
+
+Signed MultiplySigned(const Signed& lhs, const Signed& rhs, int threads) {
+  Signed result;
+  result.magnitude = Multiply(lhs.magnitude, rhs.magnitude, threads);
+  result.negative = lhs.negative != rhs.negative && View(result.magnitude).size > 0;
+  return result;
+}
+
+// Умножает число на маленькое число `factor`.
+Signed MultiplySmall(Signed value, Limb factor) {
+  const Limb carry = MultiplyByWord(value.magnitude.data(), value.magnitude.size(), factor);
+  if (carry > 0) {
+    value.magnitude.push_back(carry);
+  }
+  return value;
+}
+
+// Делит число на маленькое число `divisor`, на которое оно делится нацело.
+Signed DivideExact(Signed value, Limb divisor) {
+  uint64_t remainder = 0;
+  for (size_t i = value.magnitude.size(); i-- > 0;) {
+    uint64_t current = (remainder << 32) | value.magnitude[i];
+    value.magnitude[i] = (Limb)(current / divisor);
+    remainder = current % divisor;
+  }
+  if (remainder != 0) {
+    throw std::runtime_error("Inexact division in Toom-3 interpolation");
+  }
+  return value;
+}
+
+// Алгоритм Тоома-Кука: числа рассматриваются как многочлены второй степени
+// от `B^k`, произведение многочленов восстанавливается по значениям в точках
+// 0, 1, -1, -2 и бесконечности (последовательность интерполяции Бодрато).
+void MultiplyToom3(View lhs, View rhs, Limb* result, int threads) {
+  const size_t k = (std::max(lhs.size, rhs.size) + 2) / 3;
+  auto evaluate = [k](View value) {
+    Signed part0(value.Slice(0, k)), part1(value.Slice(k, k)), part2(value.Slice(2 * k, k));
+    Signed sum02 = AddSigned(part0, part2);
+    Signed at_one = AddSigned(sum02, part1);
+    Signed at_minus_one = SubtractSigned(sum02, part1);
+    Signed at_minus_two = SubtractSigned(MultiplySmall(AddSigned(at_minus_one, part2), 2), part0);
+    return std::vector<Signed>{part0, at_one, at_minus_one, at_minus_two, part2};
+  };
+  std::vector<Signed> lhs_values = evaluate(lhs);
+  std::vector<Signed> rhs_values = evaluate(rhs);
+  std::vector<Signed> products(5);
+  for (size_t i = 0; i < 5; ++i) {
+    products[i] = MultiplySigned(lhs_values[i], rhs_values[i], threads);
+  }
+  const Signed& r0 = products[0];
+  const Signed& r4 = products[4];
+  Signed r3 = DivideExact(SubtractSigned(products[3], products[1]), 3);
+  Signed r1 = DivideExact(SubtractSigned(products[1], products[2]), 2);
+  Signed r2 = SubtractSigned(products[2], r0);
+  r3 = AddSigned(DivideExact(SubtractSigned(r2, r3), 2), MultiplySmall(r4, 2));
+  r2 = SubtractSigned(AddSigned(r2, r1), r4);
+  r1 = SubtractSigned(r1, r3);
+
+  const size_t size = lhs.size + rhs.size;
+  std::fill(result, result + size, 0);
+  const Signed* coefficients[] = {&r0, &r1, &r2, &r3, &r4};
+  for (size_t i = 0; i < 5; ++i) {
+    if (coefficients[i]->negative) {
+      throw std::runtime_error("Negative coefficient in Toom-3 interpolation");
+    }
+    AddShifted(result, size, coefficients[i]->magnitude, i * k);
+  }
+}
+
+// Арифметика по простому модулю `P` с первообразным корнем `G`. Модуль
+// задается параметром шаблона, чтобы компилятор заменил деление умножением.
+template <uint32_t P, uint32_t G>
+struct NttPrime {
+  static constexpr uint32_t kModulus = P;
+
+  static constexpr uint32_t Power(uint64_t base, uint64_t exponent) {
+    uint64_t result = 1;
+    base %= P;
+    while (exponent > 0) {
+      if (exponent & 1) {
+        result = result * base % P;
+      }
+      base = base * base % P;
+      exponent >>= 1;
+    }
+    return result;
+  }
+
+  // Преобразование Фурье длины `values.size()` (степень двойки) над
+  // полем вычетов по модулю `P`.
+  static void Transform(std::vector<uint32_t>& values, bool inverse) {
+    const size_t size = values.size();
+    for (size_t i = 1, j = 0; i < size; ++i) {
+      size_t bit = size >> 1;
+      for (; j & bit; bit >>= 1) {
+        j ^= bit;
+      }
+      j ^= bit;
+      if (i < j) {
+        std::swap(values[i], values[j]);
+      }
+    }
+    std::vector<uint32_t> roots(size / 2 + 1);
+    for (size_t length = 2; length <= size; length <<= 1) {
+      uint64_t root = Power(G, (P - 1) / length);
+      if (inverse) {
+        root = Power(root, P - 2);
+      }
+      const size_t half = length / 2;
+      roots[0] = 1;
+      for (size_t j = 1; j < half; ++j) {
+        roots[j] = roots[j - 1] * root % P;
+      }
+      for (size_t i = 0; i < size; i += length) {
+        for (size_t j = 0; j < half; ++j) {
+          const uint32_t u = values[i + j];
+          const uint32_t v = (uint64_t)values[i + j + half] * roots[j] % P;
+          values[i + j] = u + v >= P ? u + v - P : u + v;
+          values[i + j + half] = u >= v ? u - v : u + P - v;
+        }
+      }
+    }
+    if (inverse) {
+      const uint64_t size_inverse = Power(size, P - 2);
+      for (uint32_t& value : values) {
+        value = value * size_inverse % P;
+      }
+    }
+  }
+
+  // Циклическая свертка длины `size` цифр `lhs` и `rhs` по модулю `P`. Если
+  // `parallel` истинно, прямые преобразования множителей выполняются
+  // параллельно.
+  static std::vector<uint32_t> Convolution(View lhs, View rhs, size_t size, bool parallel) {
+    auto load = [size](View value) {
+      std::vector<uint32_t> result(size, 0);
+      for (size_t i = 0; i < value.size; ++i) {
+        result[i] = value.data[i] % P;
+      }
+      return result;
+    };
+    std::vector<uint32_t> lhs_values = load(lhs);
+    // При возведении в квадрат достаточно одного прямого преобразования.
+    if (lhs.data == rhs.data && lhs.size == rhs.size) {
+      Transform(lhs_values, false);
+      for (uint32_t& value : lhs_values) {
+        value = (uint64_t)value * value % P;
+      }
+    }
+    else {
+      std::vector<uint32_t> rhs_values = load(rhs);
+      ParallelFor(2, parallel ? 2 : 1, [&](size_t i) {
+        Transform(i == 0 ? lhs_values : rhs_values, false);
+      });
+      for (size_t i = 0; i < size; ++i) {
+        lhs_values[i] = (uint64_t)lhs_values[i] * rhs_values[i] % P;
+      }
+    }
+    Transform(lhs_values, true);
+    return lhs_values;
+  }
+};
+
+// Модули выбраны так, что `P - 1` делится на 2^26, а произведение модулей
+// (около 2^91.6) больше любого коэффициента свертки чисел длиной до 2^26
+// цифр (меньше 2^64 * 2^26).
+using Prime1 = NttPrime<469762049, 3>;
+using Prime2 = NttPrime<1811939329, 13>;
+using Prime3 = NttPrime<2013265921, 31>;
+constexpr size_t kMaxNttSize = size_t(1) << 26;
+
+void MultiplyNtt(View lhs, View rhs, Limb* result, int threads) {
+  const size_t result_size = lhs.size + rhs.size;
+  size_t size = 1;
+  while (size < result_size) {
+    size <<= 1;
+  }
+  if (size > kMaxNttSize) {
+    // Свертка такой длины не восстанавливается по трем модулям - разбиваем
+    // числа на части.
+    MultiplyToom3(lhs, rhs, result, threads);
+    return;
+  }
+  // Свертки по разным модулям независимы и вычисляются параллельно.
+  std::vector<uint32_t> residues[3];
+  const bool parallel_operands = threads >= 6;
+  ParallelFor(3, threads, [&](size_t i) {
+    if (i == 0) {
+      residues[0] = Prime1::Convolution(lhs, rhs, size, parallel_operands);
+    }
+    else if (i == 1) {
+      residues[1] = Prime2::Convolution(lhs, rhs, size, parallel_operands);
+    }
+    else {
+      residues[2] = Prime3::Convolution(lhs, rhs, size, parallel_operands);
+    }
+  });
+
+  // Восстанавливаем коэффициенты свертки по остаткам (алгоритм Гарнера) и
+  // переносим разряды.
+  constexpr uint64_t p1 = Prime1::kModulus, p2 = Prime2::kModulus, p3 = Prime3::kModulus;
+  constexpr uint64_t p1_inverse_mod_p2 = Prime2::Power(p1, p2 - 2);
+  constexpr uint64_t p1_inverse_mod_p3 = Prime3::Power(p1, p3 - 2);
+  constexpr uint64_t p2_inverse_mod_p3 = Prime3::Power(p2, p3 - 2);
+  unsigned __int128 carry = 0;
+  for (size_t i = 0; i < result_size; ++i) {
+    const uint64_t x1 = residues[0][i];
+    const uint64_t x2 = (residues[1][i] + p2 - x1 % p2) % p2 * p1_inverse_mod_p2 % p2;
+    uint64_t x3 = (residues[2][i] + p3 - x1 % p3) % p3 * p1_inverse_mod_p3 % p3;
+    x3 = (x3 + p3 - x2 % p3) % p3 * p2_inverse_mod_p3 % p3;
+    carry += x1 + (unsigned __int128)x2 * p1 + (unsigned __int128)x3 * p1 * p2;
+    result[i] = (Limb)carry;
+    carry >>= 32;
+  }
+}
+
+void MultiplyWith(MultiplicationAlgorithm algorithm, View lhs, View rhs, Limb* result, int threads) {
+  if (lhs.size == 0 || rhs.size == 0) {
+    std::fill(result, result + lhs.size + rhs.size, 0);
+    return;
+  }
+  switch (algorithm) {
+    case MultiplicationAlgorithm::Schoolbook:
+      return MultiplySchoolbook(lhs, rhs, result);
+    case MultiplicationAlgorithm::Karatsuba:
+      return MultiplyKaratsuba(lhs, rhs, result, threads);
+    case MultiplicationAlgorithm::Toom3:
+      return MultiplyToom3(lhs, rhs, result, threads);
+    case MultiplicationAlgorithm::Ntt:
+      return MultiplyNtt(lhs, rhs, result, threads);
+  }
+  throw std::runtime_error("Unknown multiplication algorithm");
+}
+
+// Выбирает алгоритм по размеру меньшего множителя.
+void MultiplyInto(View lhs, View rhs, Limb* result, int threads) {
+  if (lhs.size < rhs.size) {
+    std::swap(lhs, rhs);
+  }
+  if (rhs.size == 0) {
+    std::fill(result, result + lhs.size, 0);
+    return;
+  }
+  if (rhs.size < thresholds.karatsuba) {
+    return MultiplySchoolbook(lhs, rhs, result);
+  }
+  if (rhs.size >= thresholds.ntt) {
+    return MultiplyNtt(lhs, rhs, result, threads);
+  }
+  if (lhs.size >= 2 * rhs.size) {
+    return MultiplyUnbalanced(lhs, rhs, result, threads);
+  }
+  if (rhs.size < thresholds.toom3) {
+    return MultiplyKaratsuba(lhs, rhs, result, threads);
+  }
+  return MultiplyToom3(lhs, rhs, result, threads);
+}
+
+}
+
+MultiplicationThresholds DefaultMultiplicationThresholds(LimbKernel kernel) {
+  switch (kernel) {
+    case LimbKernel::Scalar:
+      return {48, 5000, 10000};
+    case LimbKernel::Avx2:
+      return {128, 5000, 10000};
+    case LimbKernel::Avx512Ifma:
+      return {512, 20000, 40000};
+  }
+  throw std::runtime_error("Unknown limb kernel");
+}
+
+MultiplicationThresholds GetMultiplicationThresholds() {
+  return thresholds;
+}
+
+void SetMultiplicationThresholds(const MultiplicationThresholds& value) {
+  if (value.karatsuba < 2 || value.toom3 < 3) {
+    throw std::runtime_error("Multiplication thresholds are too small");
+  }
+  thresholds = value;
+}
+
+std::vector<uint32_t> MultiplyLimbs(const std::vector<uint32_t>& lhs,
+                                    const std::vector<uint32_t>& rhs,
+                                    int threads) {
+  Limbs result(lhs.size() + rhs.size());
+  MultiplyLimbsInto(lhs.data(), lhs.size(), rhs.data(), rhs.size(), result.data(), threads);
+  return result;
+}
+
+void MultiplyLimbsInto(const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size,
+                       uint32_t* result, int threads) {
+  const View lhs_view(lhs, lhs_size), rhs_view(rhs, rhs_size);
+  const size_t size = lhs_view.size + rhs_view.size;
+  MultiplyInto(lhs_view, rhs_view, result, threads);
+  std::fill(result + size, result + lhs_size + rhs_size, 0);
+}
+
+std::vector<uint32_t> MultiplyLimbsWith(MultiplicationAlgorithm algorithm,
+                                        const std::vector<uint32_t>& lhs,
+                                        const std::vector<uint32_t>& rhs) {
+  const View lhs_view(lhs), rhs_view(rhs);
+  Limbs result(lhs.size() + rhs.size(), 0);
+  MultiplyWith(algorithm, lhs_view, rhs_view, result.data(), 1);
+  return result;
+}
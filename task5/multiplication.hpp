@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "limb_kernels.hpp"
+
+// Алгоритмы умножения длинных чисел.
+enum struct MultiplicationAlgorithm {
+  // Умножение "в столбик", O(n^2).
+  Schoolbook,
+  // Алгоритм Карацубы, O(n^1.58).
+  Karatsuba,
+  // Алгоритм Тоома-Кука с разбиением на 3 части, O(n^1.46).
+  Toom3,
+  // Умножение через теоретико-числовое преобразование Фурье по трем простым
+  // модулям с восстановлением по китайской теореме об остатках,
+  // O(n log n).
+  Ntt,
+};
+
+// Размеры меньшего из множителей (в 32-битных цифрах), начиная с которых
+// используется соответствующий алгоритм.
+struct MultiplicationThresholds {
+  size_t karatsuba = 48;
+  size_t toom3 = 5000;
+  size_t ntt = 10000;
+};
+
+// Пороги для реализации внутренних циклов `kernel`, подобранные программой
+// `task5/bench_multiply` (`make task5-tune`): чем быстрее умножение "в
+// столбик", тем позже выгодно переходить к алгоритму Карацубы. Изначально
+// используются пороги для `DetectLimbKernel()`.
+MultiplicationThresholds DefaultMultiplicationThresholds(LimbKernel kernel);
+
+MultiplicationThresholds GetMultiplicationThresholds();
+// Задает пороги выбора алгоритма. Должна вызываться до начала вычислений.
+void SetMultiplicationThresholds(const MultiplicationThresholds& thresholds);
+
+// Произведение двух чисел, заданных массивами 32-битных цифр от младшей к
+// старшей. Алгоритм выбирается по размерам множителей. Если `threads` больше
+// 1, умножения через преобразование Фурье выполняются в нескольких потоках.
+std::vector<uint32_t> MultiplyLimbs(const std::vector<uint32_t>& lhs,
+                                    const std::vector<uint32_t>& rhs,
+                                    int threads = 1);
+
+// То же, но произведение записывается в `result` - массив из
+// `lhs_size + rhs_size` цифр (например, в общую с другим процессом память),
+// а не в новый массив. `result` не должен пересекаться с множителями.
+void MultiplyLimbsInto(const uint32_t* lhs, size_t lhs_size, const uint32_t* rhs, size_t rhs_size,
+                       uint32_t* result, int threads = 1);
+
+// То же, но на верхнем уровне всегда используется `algorithm` (вложенные
+// умножения выбирают алгоритм по размерам). Используется для подбора порогов
+// и проверки алгоритмов друг другом.
+std::vector<uint32_t> MultiplyLimbsWith(MultiplicationAlgorithm algorithm,
+                                        const std::vector<uint32_t>& lhs,
+                                        const std::vector<uint32_t>& rhs);
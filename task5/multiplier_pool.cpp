@@ -0,0 +1,124 @@
+#include "multiplier_pool.hpp"
+
+namespace {
+
+// Пул и номер потока пула, выполняющегося в текущем потоке.
+thread_local const MultiplierPool* current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}
+
+MultiplierPool::MultiplierPool(std::vector<std::unique_ptr<AsyncMultiplier>> multipliers) {
+  for (auto& multiplier : multipliers) {
+    workers.push_back(std::make_unique<Worker>());
+    workers.back()->multiplier = std::move(multiplier);
+  }
+  // Потоки запускаются после создания всех очередей: поток может сразу
+  // начать перехватывать задачи из чужих очередей.
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->thread = std::thread(&MultiplierPool::Run, this, i);
+  }
+}
+
+MultiplierPool::~MultiplierPool() {
+  std::unique_lock lock(mutex);
+  all_done.wait(lock, [this]() { return pending == 0; });
+  lock.unlock();
+  should_finish = true;
+  for (auto& worker : workers) {
+    std::unique_lock worker_lock(worker->mutex);
+    worker->has_tasks.notify_one();
+  }
+  for (auto& worker : workers) {
+    worker->thread.join();
+    worker->multiplier->Finish();
+  }
+}
+
+void MultiplierPool::Submit(Task task) {
+  const size_t index = current_pool == this ? current_worker : next_worker++ % workers.size();
+  ++pending;
+  ++queued;
+  {
+    std::unique_lock lock(workers[index]->mutex);
+    workers[index]->tasks.push_back(std::move(task));
+  }
+  WakeOne(index);
+}
+
+void MultiplierPool::Wait() {
+  std::unique_lock lock(mutex);
+  all_done.wait(lock, [this]() { return pending == 0; });
+  if (error) {
+    std::exception_ptr error_ = error;
+    error = nullptr;
+    std::rethrow_exception(error_);
+  }
+}
+
+std::vector<std::chrono::nanoseconds> MultiplierPool::BusyTimes() {
+  std::vector<std::chrono::nanoseconds> result;
+  for (auto& worker : workers) {
+    result.push_back(worker->multiplier->GetBusyTime());
+  }
+  return result;
+}
+
+void MultiplierPool::Run(size_t index) {
+  current_pool = this;
+  current_worker = index;
+  Worker& worker = *workers[index];
+  while (true) {
+    if (Task task = TryTake(index)) {
+      try {
+        task(*worker.multiplier);
+      }
+      catch (...) {
+        std::unique_lock lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+      if (--pending == 0) {
+        std::unique_lock lock(mutex);
+        all_done.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock lock(worker.mutex);
+    worker.idle = true;
+    worker.has_tasks.wait(lock, [this]() { return queued > 0 || should_finish; });
+    worker.idle = false;
+    if (queued == 0 && should_finish) {
+      return;
+    }
+  }
+}
+
+MultiplierPool::Task MultiplierPool::TryTake(size_t index) {
+  for (size_t i = 0; i < workers.size(); ++i) {
+    Worker& worker = *workers[(index + i) % workers.size()];
+    std::unique_lock lock(worker.mutex);
+    if (!worker.tasks.empty()) {
+      Task task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+      lock.unlock();
+      --queued;
+      return task;
+    }
+  }
+  return nullptr;
+}
+
+void MultiplierPool::WakeOne(size_t index) {
+  // Сначала будим владельца очереди, а если он занят - любой спящий поток:
+  // он перехватит задачу.
+  for (size_t i = 0; i < workers.size(); ++i) {
+    Worker& worker = *workers[(index + i) % workers.size()];
+    if (worker.idle.exchange(false)) {
+      std::unique_lock lock(worker.mutex);
+      worker.has_tasks.notify_one();
+      return;
+    }
+  }
+}
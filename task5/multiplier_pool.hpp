@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "async_multiplier.hpp"
+
+// Пул вычислителей с очередями задач и перехватом работы (work stealing).
+// Каждым вычислителем управляет свой поток пула со своей очередью задач.
+// Задача получает вычислитель потока, который ее выполняет: обычно она
+// отправляет ему произведение вызовом `SetTask()` или `SetFactorsTask()` и
+// ждет результата `GetResult()`. Поток берет задачи из начала своей очереди,
+// а когда она пуста - из начала очередей других потоков, поэтому задачи
+// разных запросов выполняются примерно в порядке поступления, и ни один
+// вычислитель не простаивает, пока есть невыполненные задачи. Общей
+// блокировки на пути задачи нет: очереди защищены своими мьютексами,
+// счетчики атомарны, а свободный поток будится своей условной переменной.
+class MultiplierPool {
+public:
+  using Task = std::function<void(AsyncMultiplier&)>;
+
+  explicit MultiplierPool(std::vector<std::unique_ptr<AsyncMultiplier>> multipliers);
+  // Дожидается выполнения всех задач и завершает вычислители.
+  ~MultiplierPool();
+
+  MultiplierPool(const MultiplierPool&) = delete;
+  MultiplierPool& operator=(const MultiplierPool&) = delete;
+
+  size_t Size() const { return workers.size(); }
+
+  // Добавляет задачу в очередь. Задачи, добавленные из потока пула, попадают
+  // в очередь этого потока, остальные распределяются по очередям по кругу.
+  // Метод можно вызывать из задач.
+  void Submit(Task task);
+
+  // Блокирует выполнение, пока не будут выполнены все добавленные задачи,
+  // включая добавленные самими задачами. Если какая-либо задача завершилась
+  // исключением, оно пробрасывается (первое из них).
+  void Wait();
+
+  // Процессорное время, затраченное каждым вычислителем на полученные
+  // результаты (см. `AsyncMultiplier::GetBusyTime()`). Вызывается, когда пул
+  // не выполняет задач, например после `Wait()`.
+  std::vector<std::chrono::nanoseconds> BusyTimes();
+
+private:
+  struct Worker {
+    std::unique_ptr<AsyncMultiplier> multiplier;
+    // Мьютекс защищает очередь и используется для ожидания задач на
+    // `has_tasks`. `idle` - поток спит (или собирается заснуть) на
+    // `has_tasks`; флаг сбрасывает тот, кто его будит.
+    std::mutex mutex;
+    std::condition_variable has_tasks;
+    std::deque<Task> tasks;
+    std::atomic<bool> idle{false};
+    std::thread thread;
+  };
+
+  void Run(size_t index);
+  // Забирает задачу из очереди потока `index` или из очереди другого потока.
+  // Возвращает пустую задачу, если все очереди пусты.
+  Task TryTake(size_t index);
+  // Будит один спящий поток, начиная с потока `index`.
+  void WakeOne(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  // `queued` - количество задач в очередях (увеличивается до добавления в
+  // очередь, уменьшается после извлечения), `pending` - количество
+  // добавленных, но еще не выполненных задач. Поток засыпает, только
+  // отметив себя в `idle` и убедившись, что `queued == 0`, а `Submit()`
+  // будит спящий поток после увеличения `queued`, поэтому задача не может
+  // остаться в очереди при спящих потоках.
+  std::atomic<size_t> queued{0};
+  std::atomic<size_t> pending{0};
+  std::atomic<size_t> next_worker{0};
+  std::atomic<bool> should_finish{false};
+  // Мьютекс `mutex` нужен только для ожидания `pending == 0` и для `error`.
+  std::mutex mutex;
+  std::condition_variable all_done;
+  std::exception_ptr error;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Общий для процесса пул потоков-помощников для `ParallelFor()`. Потоков
+// на один меньше, чем логических вычислителей (но не меньше одного), поэтому
+// вложенные и одновременные вызовы `ParallelFor()` не создают новых потоков
+// и не превышают это количество. Пул создается при первом использовании и
+// не уничтожается: его потоки завершаются вместе с процессом, в том числе в
+// дочерних процессах, завершающихся через `exit()`.
+class HelperPool {
+public:
+  // Пул текущего процесса или nullptr. Пул принадлежит создавшему его
+  // процессу: в процессе, созданном `fork()` после запуска пула, потоков
+  // пула нет, и новый пул там не создается - такой процесс (например,
+  // вычислитель `--use-processes`) выполняет `ParallelFor()` в одном потоке.
+  static HelperPool* ForCurrentProcess() {
+    static HelperPool* pool = new HelperPool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return getpid() == pool->owner ? pool : nullptr;
+  }
+
+  void Submit(std::function<void()> job) {
+    std::unique_lock lock(mutex);
+    jobs.push_back(std::move(job));
+    lock.unlock();
+    has_jobs.notify_one();
+  }
+
+  size_t Size() const { return size; }
+
+private:
+  explicit HelperPool(size_t size) : size(size), owner(getpid()) {
+    for (size_t i = 0; i < size; ++i) {
+      std::thread(&HelperPool::Run, this).detach();
+    }
+  }
+
+  void Run() {
+    while (true) {
+      std::unique_lock lock(mutex);
+      has_jobs.wait(lock, [this]() { return !jobs.empty(); });
+      std::function<void()> job = std::move(jobs.front());
+      jobs.pop_front();
+      lock.unlock();
+      job();
+    }
+  }
+
+  const size_t size;
+  const pid_t owner;
+  std::mutex mutex;
+  std::condition_variable has_jobs;
+  std::deque<std::function<void()>> jobs;
+};
+
+// Выполняет `job(i)` для всех `i` от 0 до `count - 1`, используя не больше
+// `threads` потоков (включая текущий). Потоки забирают индексы по одному,
+// поэтому задачи разной длительности распределяются между ними динамически.
+//
+// Дополнительные потоки берутся из `HelperPool`. Текущий поток сам
+// забирает индексы и ждет только те, что уже выполняются другими потоками,
+// поэтому вызов не блокируется, даже если все потоки пула заняты (например,
+// вложенными вызовами). Исключение из `job` пробрасывается вызывающему
+// потоку (первое из них); индексы, выданные после него, пропускаются.
+inline void ParallelFor(size_t count, int threads, const std::function<void(size_t)>& job) {
+  auto run_serially = [&]() {
+    for (size_t i = 0; i < count; ++i) {
+      job(i);
+    }
+  };
+  // Однопоточные вызовы не обращаются к пулу и не создают его.
+  if (threads <= 1 || count <= 1) {
+    run_serially();
+    return;
+  }
+  HelperPool* pool = HelperPool::ForCurrentProcess();
+  if (pool == nullptr) {
+    run_serially();
+    return;
+  }
+  const size_t workers = std::min<size_t>({(size_t)threads, count, pool->Size() + 1});
+  // Состояние разделяется с задачами пула: задача, начавшая выполняться
+  // после возврата из `ParallelFor()`, не найдет свободных индексов и
+  // обратится только к нему.
+  struct State {
+    const std::function<void(size_t)>* job;
+    size_t count;
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::mutex mutex;
+    std::condition_variable all_done;
+    size_t done = 0;
+    std::exception_ptr error;
+  };
+  auto state = std::make_shared<State>();
+  state->job = &job;
+  state->count = count;
+  auto work = [state]() {
+    for (size_t i = state->next++; i < state->count; i = state->next++) {
+      std::exception_ptr error;
+      if (!state->failed) {
+        try {
+          (*state->job)(i);
+        }
+        catch (...) {
+          error = std::current_exception();
+          state->failed = true;
+        }
+      }
+      std::unique_lock lock(state->mutex);
+      if (error && !state->error) {
+        state->error = error;
+      }
+      if (++state->done == state->count) {
+        state->all_done.notify_all();
+      }
+    }
+  };
+  for (size_t i = 1; i < workers; ++i) {
+    pool->Submit(work);
+  }
+  work();
+  // Все индексы уже выданы; дожидаемся тех, что выполняются другими потоками.
+  std::unique_lock lock(state->mutex);
+  state->all_done.wait(lock, [&]() { return state->done == state->count; });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
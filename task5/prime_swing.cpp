@@ -0,0 +1,102 @@
+#include "prime_swing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Размер отрезка решета в нечетных числах (один байт на число).
+constexpr uint64_t kSegmentSize = 32768;
+
+}
+
+std::vector<uint32_t> SievePrimes(uint64_t limit) {
+  std::vector<uint32_t> primes;
+  if (limit < 2) {
+    return primes;
+  }
+  primes.push_back(2);
+  // Простые до `sqrt(limit)` находим обычным решетом.
+  const uint64_t root = std::sqrt((double)limit) + 1;
+  std::vector<bool> is_composite(root + 1, false);
+  std::vector<uint32_t> base_primes;
+  for (uint64_t i = 3; i <= root; i += 2) {
+    if (!is_composite[i]) {
+      base_primes.push_back(i);
+      for (uint64_t j = i * i; j <= root; j += 2 * i) {
+        is_composite[j] = true;
+      }
+    }
+  }
+  // Отрезок с номером `segment` содержит нечетные числа
+  // `low, low + 2, ..., low + 2 * (kSegmentSize - 1)`, где
+  // `low = 2 * kSegmentSize * segment + 1`.
+  std::vector<char> segment_composite(kSegmentSize);
+  for (uint64_t low = 1; low <= limit; low += 2 * kSegmentSize) {
+    std::fill(segment_composite.begin(), segment_composite.end(), 0);
+    const uint64_t high = std::min(limit, low + 2 * (kSegmentSize - 1));
+    for (uint64_t prime : base_primes) {
+      if (prime * prime > high) {
+        break;
+      }
+      // Первое нечетное кратное `prime`, не меньшее `max(low, prime^2)`.
+      uint64_t start = std::max(prime * prime, (low + prime - 1) / prime * prime);
+      if (start % 2 == 0) {
+        start += prime;
+      }
+      for (uint64_t j = start; j <= high; j += 2 * prime) {
+        segment_composite[(j - low) / 2] = 1;
+      }
+    }
+    for (uint64_t i = std::max<uint64_t>(low, 3); i <= high; i += 2) {
+      if (!segment_composite[(i - low) / 2]) {
+        primes.push_back(i);
+      }
+    }
+  }
+  return primes;
+}
+
+uint64_t LegendreExponent(uint64_t n, uint64_t prime) {
+  uint64_t exponent = 0;
+  while (n > 0) {
+    n /= prime;
+    exponent += n;
+  }
+  return exponent;
+}
+
+std::vector<uint64_t> OddSwingFactors(uint64_t n, const std::vector<uint32_t>& primes) {
+  std::vector<uint64_t> factors;
+  const uint64_t root = std::sqrt((double)n);
+  for (uint32_t prime : primes) {
+    if (prime > n) {
+      break;
+    }
+    if (prime == 2) {
+      continue;
+    }
+    if (prime > n / 2) {
+      // Простые из (n/2, n] входят в первой степени.
+      factors.push_back(prime);
+    }
+    else if (prime > root) {
+      // При p > sqrt(n) ненулевое только floor(n / p).
+      if ((n / prime) % 2 == 1) {
+        factors.push_back(prime);
+      }
+    }
+    else {
+      uint64_t power = 1;
+      for (uint64_t q = n / prime; q > 0; q /= prime) {
+        if (q % 2 == 1) {
+          power *= prime;
+        }
+      }
+      if (power > 1) {
+        factors.push_back(power);
+      }
+    }
+  }
+  return factors;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Простые числа, не превосходящие `limit`, в порядке возрастания. Используется
+// сегментированное решето Эратосфена: составные числа вычеркиваются в
+// отрезках, помещающихся в кэш первого уровня, простыми числами до
+// `sqrt(limit)`.
+std::vector<uint32_t> SievePrimes(uint64_t limit);
+
+// Показатель степени простого `prime` в разложении `n!` (формула Лежандра).
+uint64_t LegendreExponent(uint64_t n, uint64_t prime);
+
+// Множители нечетной части "качающегося факториала" (prime swing) Лушного
+// `n≀ = n! / (floor(n/2)!)^2`: для каждого нечетного простого `p <= n` -
+// `p^e`, где `e` - количество нечетных `floor(n / p^k)`, `k >= 1`. Все
+// множители не превосходят `n`. `primes` должны содержать все простые до `n`.
+std::vector<uint64_t> OddSwingFactors(uint64_t n, const std::vector<uint32_t>& primes);
@@ -0,0 +1,267 @@
+#include "radix.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "multiplication.hpp"
+#include "parallel.hpp"
+
+namespace {
+
+using Limbs = std::vector<uint32_t>;
+
+// Основание, по которому число раскладывается при переводе в десятичную
+// запись: наибольшая степень 10, помещающаяся в цифру.
+constexpr uint32_t kDecimalBase = 1000000000;
+constexpr size_t kDecimalBaseDigits = 9;
+// Числа не длиннее стольких цифр переводятся последовательным делением на
+// `kDecimalBase`.
+constexpr size_t kBaseCaseLimbs = 64;
+// Обратное к числу не длиннее стольких цифр вычисляется делением "в
+// столбик" по одному биту.
+constexpr size_t kReciprocalBaseLimbs = 8;
+
+void Normalize(Limbs& value) {
+  while (!value.empty() && value.back() == 0) {
+    value.pop_back();
+  }
+}
+
+int Compare(const Limbs& lhs, const Limbs& rhs) {
+  if (lhs.size() != rhs.size()) {
+    return lhs.size() < rhs.size() ? -1 : 1;
+  }
+  for (size_t i = lhs.size(); i-- > 0;) {
+    if (lhs[i] != rhs[i]) {
+      return lhs[i] < rhs[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+Limbs Add(const Limbs& lhs, const Limbs& rhs) {
+  Limbs result(std::max(lhs.size(), rhs.size()) + 1, 0);
+  uint64_t carry = 0;
+  for (size_t i = 0; i + 1 < result.size(); ++i) {
+    carry += (uint64_t)(i < lhs.size() ? lhs[i] : 0) + (i < rhs.size() ? rhs[i] : 0);
+    result[i] = (uint32_t)carry;
+    carry >>= 32;
+  }
+  result.back() = carry;
+  Normalize(result);
+  return result;
+}
+
+// Разность `lhs - rhs`, `lhs >= rhs`.
+Limbs Subtract(const Limbs& lhs, const Limbs& rhs) {
+  Limbs result(lhs.size());
+  int64_t borrow = 0;
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    int64_t difference = (int64_t)lhs[i] - (i < rhs.size() ? rhs[i] : 0) - borrow;
+    borrow = difference < 0;
+    result[i] = (uint32_t)(difference + (borrow << 32));
+  }
+  Normalize(result);
+  return result;
+}
+
+Limbs Multiply(const Limbs& lhs, const Limbs& rhs, int threads) {
+  if (lhs.empty() || rhs.empty()) {
+    return {};
+  }
+  Limbs result = MultiplyLimbs(lhs, rhs, threads);
+  Normalize(result);
+  return result;
+}
+
+// Частное от деления на 2^(32 count).
+Limbs ShiftRight(const Limbs& value, size_t count) {
+  return count >= value.size() ? Limbs() : Limbs(value.begin() + count, value.end());
+}
+
+// Произведение на 2^(32 count).
+Limbs ShiftLeft(const Limbs& value, size_t count) {
+  if (value.empty()) {
+    return {};
+  }
+  Limbs result(count, 0);
+  result.insert(result.end(), value.begin(), value.end());
+  return result;
+}
+
+// 2^(32 count).
+Limbs PowerOfBase(size_t count) {
+  Limbs result(count, 0);
+  result.push_back(1);
+  return result;
+}
+
+// Делением "в столбик" по одному биту вычисляет floor(2^(64 n) / divisor),
+// где n - длина `divisor`.
+Limbs SmallReciprocal(const Limbs& divisor) {
+  const size_t bits = 64 * divisor.size();
+  Limbs quotient(2 * divisor.size() + 1, 0);
+  Limbs remainder;
+  for (size_t bit = bits + 1; bit-- > 0;) {
+    // remainder = 2 remainder + (бит делимого).
+    uint32_t carry = bit == bits;
+    for (uint32_t& limb : remainder) {
+      const uint32_t next_carry = limb >> 31;
+      limb = (limb << 1) | carry;
+      carry = next_carry;
+    }
+    if (carry != 0) {
+      remainder.push_back(carry);
+    }
+    if (Compare(remainder, divisor) >= 0) {
+      remainder = Subtract(remainder, divisor);
+      quotient[bit / 32] |= 1u << (bit % 32);
+    }
+  }
+  Normalize(quotient);
+  return quotient;
+}
+
+// floor(2^(64 n) / divisor), где n - длина `divisor`. Приближение
+// вычисляется по старшим h = n / 2 + 2 цифрам делителя и уточняется одним
+// шагом метода Ньютона: v <- v + v (2^(64 n) - divisor v) / 2^(64 n), после
+// которого ошибка не превосходит нескольких единиц и исправляется
+// сравнением остатка с делителем.
+Limbs Reciprocal(const Limbs& divisor, int threads) {
+  const size_t n = divisor.size();
+  if (n <= kReciprocalBaseLimbs) {
+    return SmallReciprocal(divisor);
+  }
+  const size_t h = n / 2 + 2;
+  Limbs reciprocal = ShiftLeft(Reciprocal(ShiftRight(divisor, n - h), threads), n - h);
+  const Limbs power = PowerOfBase(2 * n);
+  Limbs product = Multiply(divisor, reciprocal, threads);
+  if (Compare(product, power) <= 0) {
+    const Limbs error = Subtract(power, product);
+    reciprocal = Add(reciprocal, ShiftRight(Multiply(reciprocal, error, threads), 2 * n));
+  }
+  else {
+    const Limbs error = Subtract(product, power);
+    reciprocal = Subtract(reciprocal, ShiftRight(Multiply(reciprocal, error, threads), 2 * n));
+  }
+  const Limbs one = {1};
+  product = Multiply(divisor, reciprocal, threads);
+  while (Compare(product, power) > 0) {
+    reciprocal = Subtract(reciprocal, one);
+    product = Subtract(product, divisor);
+  }
+  Limbs remainder = Subtract(power, product);
+  while (Compare(remainder, divisor) >= 0) {
+    reciprocal = Add(reciprocal, one);
+    remainder = Subtract(remainder, divisor);
+  }
+  return reciprocal;
+}
+
+// Делитель вместе с обратным к нему (см. `Reciprocal()`).
+struct Divisor {
+  Limbs value;
+  Limbs reciprocal;
+};
+
+// Деление с остатком `dividend < 2^(64 n)` на делитель длины n (деление
+// Барретта): частное оценивается снизу как
+// floor(floor(dividend / 2^(32 (n - 1))) * reciprocal / 2^(32 (n + 1))),
+// ошибка оценки не больше 2 и исправляется вычитаниями.
+void DivMod(const Limbs& dividend, const Divisor& divisor, int threads, Limbs& quotient, Limbs& remainder) {
+  const size_t n = divisor.value.size();
+  quotient = ShiftRight(Multiply(ShiftRight(dividend, n - 1), divisor.reciprocal, threads), n + 1);
+  remainder = Subtract(dividend, Multiply(quotient, divisor.value, threads));
+  while (Compare(remainder, divisor.value) >= 0) {
+    remainder = Subtract(remainder, divisor.value);
+    quotient = Add(quotient, {1});
+  }
+}
+
+// Записывает в `out` последние `width` десятичных цифр числа с ведущими
+// нулями, последовательно деля число на `kDecimalBase`.
+void SmallToDecimal(Limbs value, char* out, size_t width) {
+  char* end = out + width;
+  while (!value.empty()) {
+    uint64_t remainder = 0;
+    for (size_t i = value.size(); i-- > 0;) {
+      uint64_t current = (remainder << 32) | value[i];
+      value[i] = (uint32_t)(current / kDecimalBase);
+      remainder = current % kDecimalBase;
+    }
+    Normalize(value);
+    for (size_t i = 0; i < kDecimalBaseDigits && end > out; ++i) {
+      *--end = '0' + remainder % 10;
+      remainder /= 10;
+    }
+  }
+  std::fill(out, end, '0');
+}
+
+// Записывает в `out` 9 * 2^level десятичных цифр числа `value < powers[level]`
+// с ведущими нулями, где `powers[k] = 10^(9 * 2^k)`.
+void ToDecimal(const Limbs& value, size_t level, const std::vector<Divisor>& powers, char* out,
+               int threads) {
+  const size_t width = kDecimalBaseDigits << level;
+  if (value.size() <= kBaseCaseLimbs || level == 0) {
+    SmallToDecimal(value, out, width);
+    return;
+  }
+  Limbs quotient;
+  Limbs remainder;
+  DivMod(value, powers[level - 1], threads, quotient, remainder);
+  // Половины записи независимы и переводятся параллельно потоками общего
+  // пула помощников (`ParallelFor()`), так что рекурсия не создает новых
+  // потоков.
+  const int high_threads = std::max(1, threads / 2);
+  const int low_threads = std::max(1, threads - threads / 2);
+  ParallelFor(2, threads, [&](size_t i) {
+    if (i == 0) {
+      ToDecimal(quotient, level - 1, powers, out, high_threads);
+    }
+    else {
+      ToDecimal(remainder, level - 1, powers, out + width / 2, low_threads);
+    }
+  });
+}
+
+}
+
+std::string ToDecimalString(const BigInteger& value, int threads) {
+  if (value.IsZero()) {
+    return "0";
+  }
+  const Limbs& limbs = value.Limbs();
+  // Степени 10^(9 * 2^k) вычисляются возведением в квадрат, пока не
+  // превзойдут число.
+  std::vector<Divisor> powers = {{{kDecimalBase}, {}}};
+  while (Compare(powers.back().value, limbs) <= 0) {
+    powers.push_back({Multiply(powers.back().value, powers.back().value, threads), {}});
+  }
+  for (size_t k = 0; k + 1 < powers.size(); ++k) {
+    if (2 * powers[k].value.size() >= kBaseCaseLimbs) {
+      powers[k].reciprocal = Reciprocal(powers[k].value, threads);
+    }
+  }
+  const size_t level = powers.size() - 1;
+  std::string result(kDecimalBaseDigits << level, '0');
+  ToDecimal(limbs, level, powers, result.data(), threads);
+  result.erase(0, result.find_first_not_of('0'));
+  return result;
+}
+
+std::string ToHexString(const BigInteger& value) {
+  if (value.IsZero()) {
+    return "0";
+  }
+  const Limbs& limbs = value.Limbs();
+  std::string result(8 * limbs.size() + 1, '\0');
+  char* out = result.data();
+  out += snprintf(out, 9, "%x", limbs.back());
+  for (size_t i = limbs.size() - 1; i-- > 0;) {
+    out += snprintf(out, 9, "%08x", limbs[i]);
+  }
+  result.resize(out - result.data());
+  return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+#include "big_integer.hpp"
+
+// Десятичная запись числа. Короткие числа переводятся последовательным
+// делением на 10^9, длинные - рекурсивно: число делится с остатком на
+// 10^(9 * 2^k), наибольшую степень вида 10^(9 * 2^k), не превосходящую
+// квадратного корня из числа, и частное и остаток переводятся независимо.
+// Деление выполняется умножением на заранее вычисленное обратное число
+// (метод Ньютона), поэтому перевод стоит O(M(n) log n), где M(n) - стоимость
+// умножения. Половины переводятся в `threads` потоках, и умножения тоже
+// используют `threads` потоков.
+std::string ToDecimalString(const BigInteger& value, int threads = 1);
+
+// Шестнадцатеричная запись числа (строчными буквами, без префикса).
+std::string ToHexString(const BigInteger& value);
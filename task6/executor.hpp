@@ -0,0 +1,197 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Задача для `WorkStealingExecutor`: ссылка на функциональный объект и
+// признак завершения. Задача не владеет функциональным объектом и обычно
+// создается на стеке вместе с ним: поток, добавивший задачу, дожидается ее
+// вызовом `WorkStealingExecutor::Join()` до выхода из области видимости.
+class ExecutorTask {
+public:
+  template <typename Function>
+  explicit ExecutorTask(Function& function)
+      : context(&function), invoke([](void* context) { (*static_cast<Function*>(context))(); }) {}
+
+  ExecutorTask(const ExecutorTask&) = delete;
+  ExecutorTask& operator=(const ExecutorTask&) = delete;
+
+  void Run() {
+    invoke(context);
+    done.store(true, std::memory_order_release);
+  }
+
+  bool Done() const { return done.load(std::memory_order_acquire); }
+
+private:
+  void* context;
+  void (*invoke)(void*);
+  std::atomic<bool> done{false};
+};
+
+// Постоянный пул потоков с перехватом работы (work stealing). У каждого
+// потока пула своя очередь задач; еще одна очередь общая для потоков, не
+// входящих в пул. Поток добавляет задачи в конец своей очереди и сам берет
+// их оттуда же (последняя добавленная задача - самая "горячая" в кэше), а
+// свободные потоки перехватывают задачи из начала чужих очередей - самые
+// старые и, при рекурсивном делении, самые большие. Поток, ожидающий
+// задачу (`Join()`), выполняет другие задачи, пока ожидаемая не будет
+// выполнена, а засыпает, только если других задач долго нет.
+class WorkStealingExecutor {
+public:
+  // Создает пул из `threads` потоков. Поток, вызывающий `Join()`, тоже
+  // выполняет задачи, поэтому для n вычислителей достаточно n - 1 потоков.
+  explicit WorkStealingExecutor(size_t threads) {
+    for (size_t i = 0; i <= threads; ++i) {
+      queues.push_back(std::make_unique<Queue>());
+    }
+    // Последняя очередь - общая для потоков вне пула. `TryTake()` обходит
+    // массив очередей без блокировок, поэтому он заполняется целиком до
+    // запуска первого потока и больше не меняется.
+    for (size_t i = 0; i < threads; ++i) {
+      workers.emplace_back(&WorkStealingExecutor::Run, this, i);
+    }
+  }
+
+  WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+  WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+  // Завершает потоки пула. Все добавленные задачи должны быть уже выполнены.
+  ~WorkStealingExecutor() {
+    std::unique_lock lock(mutex);
+    should_finish = true;
+    lock.unlock();
+    has_tasks.notify_all();
+    for (std::thread& worker : workers) {
+      worker.join();
+    }
+  }
+
+  size_t Size() const { return workers.size(); }
+
+  // Добавляет задачу в очередь текущего потока.
+  void Spawn(ExecutorTask& task) {
+    Queue& queue = *queues[CurrentQueue()];
+    std::unique_lock queue_lock(queue.mutex);
+    queue.tasks.push_back(&task);
+    queue_lock.unlock();
+    std::unique_lock lock(mutex);
+    ++queued;
+    lock.unlock();
+    has_tasks.notify_one();
+  }
+
+  // Выполняет задачи из очередей, пока задача `task` не будет выполнена.
+  void Join(ExecutorTask& task) {
+    const size_t index = CurrentQueue();
+    size_t idle_rounds = 0;
+    while (!task.Done()) {
+      if (ExecutorTask* other = TryTake(index)) {
+        RunTask(*other);
+        idle_rounds = 0;
+      }
+      else if (idle_rounds < kJoinSpinCount) {
+        // Задачу выполняет другой поток, а других задач нет. Короткие
+        // задачи дешевле дождаться, уступая процессор.
+        ++idle_rounds;
+        std::this_thread::yield();
+      }
+      else {
+        // Засыпаем до завершения какой-нибудь задачи. Счетчик читается до
+        // повторной проверки `task`, поэтому завершение между ними не
+        // теряется.
+        const uint32_t seen = completed.load(std::memory_order_acquire);
+        if (!task.Done()) {
+          completed.wait(seen, std::memory_order_acquire);
+        }
+      }
+    }
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<ExecutorTask*> tasks;
+  };
+
+  // Количество попыток найти задачу, после которых `Join()` засыпает.
+  static constexpr size_t kJoinSpinCount = 64;
+
+  // Номер очереди текущего потока: своя у потоков пула, общая у остальных.
+  size_t CurrentQueue() const {
+    return current_executor == this ? current_worker : workers.size();
+  }
+
+  void Run(size_t index) {
+    current_executor = this;
+    current_worker = index;
+    while (true) {
+      std::unique_lock lock(mutex);
+      has_tasks.wait(lock, [this]() { return queued > 0 || should_finish; });
+      if (should_finish) {
+        return;
+      }
+      lock.unlock();
+      if (ExecutorTask* task = TryTake(index)) {
+        RunTask(*task);
+      }
+    }
+  }
+
+  // Выполняет задачу и будит потоки, заснувшие в `Join()`. Будит через
+  // счетчик исполнителя, а не через признак задачи: после установки признака
+  // ожидающий поток может вернуться из `Join()` и уничтожить задачу.
+  void RunTask(ExecutorTask& task) {
+    task.Run();
+    completed.fetch_add(1, std::memory_order_release);
+    completed.notify_all();
+  }
+
+  // Забирает задачу из конца очереди `index` или из начала другой очереди.
+  // Возвращает nullptr, если все очереди пусты.
+  ExecutorTask* TryTake(size_t index) {
+    for (size_t i = 0; i < queues.size(); ++i) {
+      Queue& queue = *queues[(index + i) % queues.size()];
+      std::unique_lock queue_lock(queue.mutex);
+      if (queue.tasks.empty()) {
+        continue;
+      }
+      ExecutorTask* task;
+      if (i == 0) {
+        task = queue.tasks.back();
+        queue.tasks.pop_back();
+      }
+      else {
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+      }
+      queue_lock.unlock();
+      std::unique_lock lock(mutex);
+      --queued;
+      return task;
+    }
+    return nullptr;
+  }
+
+  // Исполнитель, которому принадлежит текущий поток, и номер очереди этого
+  // потока в нем. У потоков, созданных не исполнителем, `current_executor`
+  // равен nullptr: они пользуются общей очередью.
+  static inline thread_local const WorkStealingExecutor* current_executor = nullptr;
+  static inline thread_local size_t current_worker = 0;
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+  // `queued` - количество задач в очередях; потоки пула спят, пока оно
+  // равно 0. Защищено мьютексом `mutex`.
+  std::mutex mutex;
+  std::condition_variable has_tasks;
+  size_t queued = 0;
+  bool should_finish = false;
+  // Количество выполненных задач; на нем засыпает `Join()`.
+  std::atomic<uint32_t> completed{0};
+};
@@ -2,18 +2,30 @@
 #include <thread>
 #include <vector>
 #include <future>
+#include <map>
+#include <mutex>
 #include <optional>
 
+#include "executor.hpp"
+
 #include <sys/shm.h>
 #include <sys/wait.h>
 #include <string.h>
+#include <unistd.h>
 
 // Тип вычислителя.
 enum struct ProcessorType {
   Thread,
-  Process
+  Process,
+  // Потоки постоянного пула с перехватом работы (`WorkStealingExecutor`),
+  // общего для всех сортировок с тем же количеством вычислителей.
+  ThreadPool
 };
 
+// Части массива не длиннее стольких элементов сортируются в пуле одной
+// задачей, без дальнейшего деления на задачи.
+constexpr size_t kMergeSortGrainSize = 4096;
+
 namespace {
 
 // Вспомогательные функции для проверки результата выполнения системных
@@ -54,9 +66,12 @@ public:
   ProcessProcessor(std::function<void()> task) {
     pid = CheckResult(fork(), "fork");
     if (pid == 0) {
-      // Выполняем задачу и завершаем выполнение дочернего процесса.
+      // Выполняем задачу и завершаем выполнение дочернего процесса. Выходим
+      // через `_exit()`: деструкторы статических объектов родителя, например
+      // пулов `SharedExecutor()`, ждали бы потоков, которых в дочернем
+      // процессе нет.
       task();
-      exit(0);
+      _exit(0);
     }
   }
 
@@ -76,8 +91,25 @@ struct Params {
   ProcessorType processor_type;
   // Если processor_type == ProcessorType::Process, shmid должно быть > 0.
   int shmid = -1;
+  // Если processor_type == ProcessorType::ThreadPool, пул, в котором
+  // выполняются задачи сортировки.
+  WorkStealingExecutor* executor = nullptr;
 };
 
+// Пул из `processors_count - 1` потоков, общий для всех сортировок с
+// `processors_count` вычислителями. Пулы создаются при первом использовании
+// и завершаются при завершении программы.
+WorkStealingExecutor& SharedExecutor(size_t processors_count) {
+  static std::mutex mutex;
+  static std::map<size_t, std::unique_ptr<WorkStealingExecutor>> executors;
+  std::unique_lock lock(mutex);
+  std::unique_ptr<WorkStealingExecutor>& executor = executors[processors_count];
+  if (!executor) {
+    executor = std::make_unique<WorkStealingExecutor>(processors_count - 1);
+  }
+  return *executor;
+}
+
 // Функция, выполняющая слияние двух частей массива.
 template <typename T, typename Compare>
 void merge(T* first, T* middle, T* last, Compare comp) {
@@ -150,6 +182,27 @@ void merge_sort_impl(T* data, size_t first, size_t last, Params params,
   size_t middle = first + (last - first) / 2;
   std::unique_ptr<Processor> processor;
 
+  if (params.executor != nullptr) {
+    // В пуле части делятся на задачи, пока они длиннее `kMergeSortGrainSize`,
+    // независимо от количества вычислителей: левая часть добавляется в
+    // очередь, откуда ее может перехватить свободный поток, правая
+    // сортируется сразу, а затем, пока левая не отсортирована, поток
+    // выполняет другие задачи пула.
+    if (last - first <= kMergeSortGrainSize) {
+      merge_sort_impl(data, first, middle, params, comp);
+      merge_sort_impl(data, middle, last, params, comp);
+    }
+    else {
+      auto sort_left = [&]() { merge_sort_impl(data, first, middle, params, comp); };
+      ExecutorTask left(sort_left);
+      params.executor->Spawn(left);
+      merge_sort_impl(data, middle, last, params, comp);
+      params.executor->Join(left);
+    }
+    merge(data + first, data + middle, data + last, comp);
+    return;
+  }
+
   // Если есть свободные вычислители, то сортируем левую часть асинхронно в
   // новом потоке/процессе.
   if (params.processors_count < 2) {
@@ -176,6 +229,15 @@ void merge_sort_impl(T* data, size_t first, size_t last, Params params,
 
 }  // namespace
 
+// Сортировка слиянием массива задачами пула `executor` (см.
+// `ProcessorType::ThreadPool`).
+template <typename T, typename Compare = std::less<T>>
+void merge_sort(T* first, T* last, Compare comp, WorkStealingExecutor& executor) {
+  Params params{executor.Size() + 1, ProcessorType::ThreadPool};
+  params.executor = &executor;
+  merge_sort_impl(first, 0, last - first, params, comp);
+}
+
 // Сортировка слиянием массива с использованием нескольких вычислителей.
 // `first` и `last` - указатели на первый и последний (невключительно) элементы
 // сортируемого массива типа T.
@@ -188,6 +250,10 @@ template <typename T, typename Compare = std::less<T>>
 void merge_sort(T* first, T* last, Compare comp = Compare{},
                 size_t processors_count = 1,
                 ProcessorType processor_type = ProcessorType::Thread) {
+  if (processor_type == ProcessorType::ThreadPool && processors_count > 1) {
+    merge_sort(first, last, comp, SharedExecutor(processors_count));
+    return;
+  }
   Params params{processors_count, processor_type};
   // Если при сортировки будут создаваться новые процессы, необходимо создать
   // сегмент разделяемой памяти для коммуникации между процессами.
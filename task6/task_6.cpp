@@ -49,6 +49,7 @@ int main() {
   t.test<int>({3, 2, 4, 3}, std::less<int>(), 2, ProcessorType::Process);
   t.test<int>({3, 2, 4, 3}, std::less<int>(), 3, ProcessorType::Process);
   t.test<int>({3, 2, 4, 3}, std::less<int>(), 4, ProcessorType::Process);
+  t.test<int>({3, 2, 4, 3}, std::less<int>(), 2, ProcessorType::ThreadPool);
 
   const int size = 100000;
   std::vector<int> test_data;
@@ -64,4 +65,29 @@ int main() {
   for (int i = 1; i < 10; ++i) {
     t.test<int>(std::vector<int>(test_data), std::less<int>(), i, ProcessorType::Process);
   }
+  for (int i = 1; i < 10; ++i) {
+    t.test<int>(std::vector<int>(test_data), std::less<int>(), i, ProcessorType::ThreadPool);
+  }
+
+  // Пул переиспользуется многими сортировками, в том числе одновременными.
+  WorkStealingExecutor executor(3);
+  std::vector<std::thread> sorters;
+  std::vector<char> sorted(4);
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    sorters.emplace_back([&test_data, &executor, &sorted, i]() {
+      bool all_sorted = true;
+      for (size_t size : {0, 1, 5000, 20000, 100000}) {
+        std::vector<int> data(test_data.begin(), test_data.begin() + size);
+        merge_sort(data.data(), data.data() + data.size(), std::greater<int>(), executor);
+        all_sorted = all_sorted && std::is_sorted(data.begin(), data.end(), std::greater<int>());
+      }
+      sorted[i] = all_sorted;
+    });
+  }
+  for (size_t i = 0; i < sorters.size(); ++i) {
+    sorters[i].join();
+    if (!sorted[i]) {
+      std::cout << "EXECUTOR TEST " << i + 1 << " FAILED" << std::endl;
+    }
+  }
 }